@@ -22,26 +22,45 @@
 #include <stdint.h>
 #include "picontroller.h"
 
+#define MAX_CHARGE_STAGES 5
+
 class BmsAlgo
 {
    public:
       static float EstimateSocFromVoltage(float lowestVoltage);
+      static float EstimateVoltageFromSoc(float soc);
       static float CalculateSocFromIntegration(float lastSoc, float asDiff);
       static float CalculateSoH(float lastSoc, float newSoc, float asDiff);
-      static float GetChargeCurrent(float maxCellVoltage, float hystVoltage, float icutoff);
+      static float GetChargeCurrent(float maxCellVoltage, float hystVoltage, float icutoff, float lowTemp);
       static float LimitMinimumCellVoltage(float minVoltage);
       static float LowTemperatureDerating(float lowTemp);
       static float HighTemperatureDerating(float highTemp, float maxTemp);
       static void SetNominalCapacity(float c) { nominalCapacity = c; }
       static void SetSocLookupPoint(uint8_t soc, uint16_t voltage);
-      static void SetCCCVCurve(uint8_t idx, float current, uint16_t voltage);
+      static void SetChargeStage(uint8_t idx, float current, uint16_t voltage, float minTemp);
+      static void SetNumChargeStages(uint8_t num);
+      static int GetActiveChargeStage() { return activeStage; }
+      static float GetProfileCurrent(float soc, float resistance, float lowTemp);
       static void SetMinVoltage(uint32_t voltage, float maxCurrent);
       static void SetControllerGains(float kp, float ki);
 
    private:
+      struct ChargeStage
+      {
+         PiControllerFloat controller;
+         float current;
+         float minTemp;
+      };
+
+      static bool StageAllowed(int idx, float lowTemp) { return lowTemp >= stages[idx].minTemp; }
+      static void EnterStage(int idx, float startCurrent);
+
       static float nominalCapacity;
       static uint16_t voltageToSoc[11];
-      static PiControllerFloat cvControllers[3]; //Support 3 consecutive CC/CV curves
+      static ChargeStage stages[MAX_CHARGE_STAGES];
+      static int numStages;
+      static int activeStage;
+      static float chargeCurrent;
       static PiControllerFloat cellMinController;
       static bool full;
 };
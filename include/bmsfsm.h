@@ -22,8 +22,21 @@
 #include "canhardware.h"
 #include "cansdo.h"
 #include "params.h"
+#include "moduledisc.h"
 
-#define MAX_SUB_MODULES 8
+#define CAN_ID_SYNC 0x7dc //Sweep synchronization from the master
+#define PDO_HEARTBEAT_MS 1000 //Module PDOs are sent at least this often
+#define PDO_DIAG_OFFSET 64 //Diagnostic messages are sent on pdobase + PDO_DIAG_OFFSET + module index
+
+struct ModuleData
+{
+   uint16_t umin; //mV
+   uint16_t umax;
+   uint16_t uavg;
+   int8_t tempmin; //°C
+   int8_t tempmax;
+   uint8_t numChan;
+};
 
 class BmsFsm: public CanCallback
 {
@@ -33,31 +46,39 @@ class BmsFsm: public CanCallback
       BmsFsm(CanMap* cm, CanSdo* cs);
       bmsstate Run(bmsstate currentState);
       int GetNumberOfModules() { return numModules; }
-      uint8_t GetCellsOfModule(uint8_t mod) { return numChan[mod]; }
-      Param::PARAM_NUM GetDataItem(Param::PARAM_NUM baseItem, int modNum = -1);
+      uint8_t GetCellsOfModule(uint8_t mod) { return modules[mod].numChan; }
+      const ModuleData* GetModuleData(uint8_t mod) { return mod < MAX_MODULES ? &modules[mod] : 0; }
+      void UpdateLocalModule();
+      void SendSync();
       void HandleRx(uint32_t canId, uint32_t data[2], uint8_t);
       void HandleClear();
       bool IsFirst();
+      bool IsMain() { return isMain; }
       bool IsEnabled();
-      uint8_t GetMaxSubmodules() { return MAX_SUB_MODULES; }
+      uint8_t GetMaxModules() { return MAX_MODULES; }
+      uint8_t GetIndex() { return ourIndex; }
+      uint16_t GetPdoBase() { return pdobase; }
 
    private:
       void MapCanSubmodule();
       void MapCanMainmodule();
+      void MapDiagnostics();
+      void RegisterModuleMessages();
+      void ReceiveModuleData(uint8_t mod, uint32_t data[2]);
+      void AdmitRestartedModule();
 
       CanMap *canMap;
       CanSdo *canSdo;
+      ModuleDiscovery discovery;
       bool isMain;
-      uint8_t recvNodeId;
-      uint8_t recvIndex;
-      uint16_t recvPdoBase;
       uint8_t ourNodeId;
       uint8_t ourIndex;
       uint16_t pdobase;
-      uint8_t infoIndex;
       uint8_t numModules;
       uint32_t cycles;
-      uint8_t numChan[MAX_SUB_MODULES + 1]; //sub modules plus one master module
+      uint32_t helloCycles;
+      uint8_t syncCounter;
+      ModuleData modules[MAX_MODULES];
 };
 
 #endif // BMSFSM_H
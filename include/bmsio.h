@@ -23,6 +23,7 @@
 #include "flyingadcbms.h"
 
 #define NO_TEMP    127
+#define MAX_CELL_CHANNELS 16
 
 
 class BmsIO
@@ -32,13 +33,60 @@ class BmsIO
       static void SwitchMux();
       static void ReadCellVoltages();
       static void TestReadCellVoltage(int chan, FlyingAdcBms::BalanceCommand cmd);
-      static void MeasureCurrent();
+      static void MeasureCurrent(float dt);
       static void SetBmsFsm(BmsFsm* b) { bmsFsm = b; }
+      static void HandleSync();
+      static void HandleCurrentFrame(const uint32_t data[2]);
+      static void HandleIsaCurrent(float current, float dt);
+      static void SetTimingViolated(bool v) { timingViolated = v; }
+      static bool IsBalancing() { return balancing; }
+      static void UpdateConfig();
 
    private:
+      /** \brief Parameters of the hot paths in the units they are used in
+       * Rebuilt by UpdateConfig() whenever one of the parameters changes
+       */
+      struct CellConfig
+      {
+         float gain[MAX_CELL_CHANNELS]; //mV per ADC digit including channel correction
+         int numChan;
+         int balMode;
+         float ubalance; //mV
+         float balanceMax; //mV
+         float balanceCharge; //As moved by one 25 ms balancing call
+      };
+
+      struct CurrentConfig
+      {
+         int mode;
+         float gain; //A per digit
+         int offset; //digits
+         float idleThresh; //A
+      };
+
+      struct TempConfig
+      {
+         int sensor;
+         int nomRes;
+         int beta;
+      };
+
+      static void SetBalanceStatus(int chan, FlyingAdcBms::BalanceStatus bstt);
       static void Accumulate(float sum, float min, float max, float avg);
+      static void IntegrateCurrent(float current, float dt);
+      static bool UseSync();
+      static bool SyncDue();
       static BmsFsm* bmsFsm;
+      static CellConfig cellConfig;
+      static CurrentConfig currentConfig;
+      static TempConfig tempConfig;
       static int muxRequest;
+      static bool timingViolated;
+      static bool balancing;
+      static volatile bool syncReceived;
+      static volatile bool syncActive;
+      static volatile uint32_t syncTime;
+      static uint32_t syncTicks;
 };
 
 #endif // BMSIO_H
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BMSSDO_H
+#define BMSSDO_H
+
+#include "cansdo.h"
+#include "bmsfsm.h"
+
+//BMS specific SDO indexes, the 0x4000 range is not used by libopeninv
+#define SDO_INDEX_SELFDISCHARGE  0x4000 //sub index: cell, leakage current in mA
+#define SDO_INDEX_CYCLES         0x4001 //sub index: mean SoC bin * 10 + depth bin, half cycles
+#define SDO_INDEX_CELLS          0x4002 //sub index: module * 16 + cell, pack wide cell voltage in mV
+#define SDO_INDEX_MODULES        0x4100 //+ModuleItem, sub index: module, see ModuleData
+#define SDO_INDEX_LIVENESS       0x4200 //+Liveness::Stat, sub index: module, frame statistics
+#define SDO_INDEX_PROFILER       0x4300 //+TaskProfiler::Stat, sub index: task, plain integers, times in CPU cycles, write to reset
+#define SDO_INDEX_JITTER         0x4400 //sub index: task * 8 + bin, number of task starts in each jitter bin
+#define SDO_INDEX_TRACE          0x4500 //+word, sub index: record, oldest first, see Trace::GetWord()
+#define SDO_INDEX_TRACECTRL      0x4503 //sub index 0: records written, 1: records dropped, write sub index 0: 1 freezes, 0 resumes
+#define SDO_INDEX_CELLTIME       0x4600 //sub index: cell * 8 + bin, seconds at cell voltage
+#define SDO_INDEX_TEMPTIME       0x4601 //sub index: bin, seconds at module temperature
+#define SDO_INDEX_EXTREMES       0x4602 //sub index: LifetimeStats::Extreme, signed integer in mV, °C or A
+#define SDO_INDEX_CAPTURECTRL    0x4700 //sub index: BmsSdo::CaptureItem, plain integers
+#define SDO_INDEX_CAPTURE        0x4701 //+sample / 256, sub index: sample % 256, curpos | curneg << 16, oldest first
+
+class BmsSdo
+{
+   public:
+      enum ModuleItem { MOD_UMIN, MOD_UMAX, MOD_UAVG, MOD_TEMPMIN, MOD_TEMPMAX, MOD_NUMCHAN, MOD_LAST };
+      //Write CAP_ARM with a Capture::Trigger mask to arm, 0 to disarm. Reading it returns the Capture::State
+      enum CaptureItem { CAP_ARM, CAP_LEVEL, CAP_SLOPE, CAP_PRETRIGGER, CAP_SOURCE, CAP_TRIGINDEX, CAP_COUNT, CAP_FIRE, CAP_LAST };
+
+      static bool ProcessCommand(CanSdo::SdoFrame* sdo);
+      static void SetBmsFsm(BmsFsm* b) { bmsFsm = b; }
+
+   private:
+      static void ReplyRead(CanSdo::SdoFrame* sdo, uint32_t value, bool valid);
+      static void ReadModuleItem(CanSdo::SdoFrame* sdo);
+      static void ReadLivenessItem(CanSdo::SdoFrame* sdo);
+      static void ProcessProfilerItem(CanSdo::SdoFrame* sdo);
+      static void ProcessTraceControl(CanSdo::SdoFrame* sdo);
+      static void ProcessCaptureControl(CanSdo::SdoFrame* sdo);
+
+      static BmsFsm* bmsFsm;
+};
+
+#endif // BMSSDO_H
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#define CAPTURE_SIZE 256 //Samples, must be a power of 2
+
+/** \brief Triggered recording of raw current sensor samples
+ *
+ * Once armed, every current sample goes into a ring buffer. When a trigger
+ * fires, recording continues until the buffer holds the configured number
+ * of pre-trigger samples and the rest is filled with post-trigger samples.
+ * Level and slope triggers are checked on each sample, state changes and
+ * manual triggers come from outside via Trigger().
+ *
+ * When not armed the sampling code only checks IsActive(). While armed it
+ * samples every 5 ms, also in low-power IDLE.
+ */
+class Capture
+{
+   public:
+      enum State { CAP_IDLE, CAP_ARMED, CAP_TRIGGERED, CAP_DONE };
+      enum Trigger { TRIG_LEVEL = 1, TRIG_SLOPE = 2, TRIG_STATE = 4, TRIG_MANUAL = 8 };
+
+      static void SetLevel(float l) { level = l; }
+      static void SetSlope(float s) { slope = s; }
+      static void SetPreTrigger(int samples);
+      static float GetLevel() { return level; }
+      static float GetSlope() { return slope; }
+      static int GetPreTrigger() { return preTrigger; }
+      static void Arm(uint8_t triggerMask);
+      static void Disarm();
+      static bool IsActive() { return active; }
+      static void AddSample(int16_t curpos, int16_t curneg, float current);
+      static void Trigger(uint8_t source);
+      static State GetState() { return state; }
+      static uint8_t GetTriggerSource() { return triggerSource; }
+      static int GetTriggerIndex();
+      static int GetCount() { return count; }
+      static bool GetSample(int idx, uint32_t& value);
+
+   private:
+      static void Fire(uint8_t source, uint32_t sample);
+
+      static uint32_t buffer[CAPTURE_SIZE];
+      static float level, slope; //A, A per sample
+      static float lastCurrent;
+      static uint32_t total; //Samples since arming
+      static uint32_t triggerSample;
+      static int preTrigger;
+      static int count;
+      static int head;
+      static int remaining;
+      static uint8_t triggers;
+      static uint8_t triggerSource;
+      static volatile State state;
+      static volatile bool active;
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CELLSTREAM_H
+#define CELLSTREAM_H
+
+#include <stdint.h>
+#include "canhardware.h"
+#include "bmsfsm.h"
+
+#define CELLSTREAM_OFFSET      32 //Cell frames are sent on pdobase + CELLSTREAM_OFFSET + module index
+#define CELLSTREAM_MAX_CELLS   16 //Cells per module
+#define CELLSTREAM_PER_FRAME   4
+
+class CellStream
+{
+   public:
+      static void SetFrameRate(float framesPerSecond);
+      static void Run(CanHardware* can, uint32_t canId, uint8_t module, const float* voltages, int numCells);
+      static void Receive(uint8_t module, const uint32_t data[2]);
+      static uint16_t GetCell(int packCell);
+      static void Encode(uint8_t mux, const uint16_t* frameCells, uint32_t data[2]);
+
+   private:
+      static uint16_t cells[MAX_MODULES * CELLSTREAM_MAX_CELLS];
+      static float framesPerCall;
+      static float credit;
+      static uint8_t nextMux;
+};
+
+#endif // CELLSTREAM_H
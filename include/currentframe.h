@@ -0,0 +1,53 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CURRENTFRAME_H
+#define CURRENTFRAME_H
+
+#include <stdint.h>
+
+#define CURRENTFRAME_OFFSET 31  //Current frame is sent on pdobase + CURRENTFRAME_OFFSET
+#define CURRENTFRAME_MAX_GAP 1000 //ms, a longer gap between frames restarts the integration
+
+/** \brief High rate current broadcast from the master's shunt
+ *
+ * Sub modules use it for their own idc and charge counters. Their idcavg
+ * still comes from the master's limits PDO, so they also work with the
+ * frame turned off.
+ *
+ * The sender averages all samples since the last frame, so no charge is lost
+ * at lower frame rates. Each frame carries the sender's time stamp, so receivers
+ * integrate over the actual interval and are not affected by bus latency.
+ */
+class CurrentFrame
+{
+   public:
+      static void SetFrameRate(float framesPerSecond);
+      static bool Run(float current, uint32_t timeMs, uint32_t data[2]);
+      static bool Receive(const uint32_t data[2], float& current, float& dt);
+
+   private:
+      static float framesPerCall;
+      static float credit;
+      static float sum;
+      static int samples;
+      static uint32_t lastTime;
+      static bool lastValid;
+};
+
+#endif // CURRENTFRAME_H
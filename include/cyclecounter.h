@@ -0,0 +1,59 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+
+#include <stdint.h>
+
+#define CC_DEPTH_BINS   10 //10% depth of discharge per bin
+#define CC_MEAN_BINS    5  //20% mean SoC per bin
+#define CC_STACK_SIZE   16
+
+class CycleCounter
+{
+   public:
+      static void AddSoc(float soc);
+      static void AddCharge(float chargeIn, float chargeOut);
+      static float GetThroughput() { return data.chargeIn + data.chargeOut; }
+      static float GetEquivalentFullCycles(float nominalCapacity);
+      static uint32_t GetHalfCycles(int meanBin, int depthBin);
+      static uint32_t* GetStorage() { return (uint32_t*)&data; }
+      static int GetStorageWords() { return sizeof(data) / sizeof(uint32_t); }
+      static void Reset();
+
+   private:
+      struct Data
+      {
+         uint32_t halfCycles[CC_MEAN_BINS * CC_DEPTH_BINS];
+         float chargeIn; //Ah
+         float chargeOut; //Ah
+      };
+
+      static void PushReversal(float soc);
+      static void CountRange(float from, float to, int halfCycles);
+
+      static Data data;
+      static float stack[CC_STACK_SIZE];
+      static int stackSize;
+      static float peak;
+      static int direction;
+      static float lastChargeIn, lastChargeOut;
+};
+
+#endif // CYCLECOUNTER_H
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ENERGYCOUNTER_H
+#define ENERGYCOUNTER_H
+
+#include <stdint.h>
+
+/** \brief Energy throughput counters
+ *
+ * The per second energy of a few Wh is far below the 1/32 kWh resolution of
+ * the energyin/energyout values, so adding it to those would round it away.
+ * The counters keep whole Wh as integer and the rest in Ws, the values only
+ * publish the totals.
+ */
+class EnergyCounter
+{
+   public:
+      static void Add(float chargeIn, float chargeOut, float voltage);
+      static void SetTotals(float kWhIn, float kWhOut);
+      static float GetIn() { return in.total; }
+      static float GetOut() { return out.total; }
+
+   private:
+      struct Counter
+      {
+         uint32_t wattHours;
+         float wattSeconds;
+         float total; //kWh, one float so readers never see a half updated counter
+      };
+
+      static void Add(Counter& c, float ws);
+      static void Set(Counter& c, float kWh);
+
+      static Counter in, out;
+};
+
+#endif // ENERGYCOUNTER_H
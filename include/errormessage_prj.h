@@ -8,5 +8,6 @@
    ERROR_MESSAGE_ENTRY(BALANCER_FAIL, ERROR_STOP) \
    ERROR_MESSAGE_ENTRY(CELL_POLARITY, ERROR_STOP) \
    ERROR_MESSAGE_ENTRY(CELL_OVERVOLTAGE, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(MODULE_STALE, ERROR_STOP) \
 
 #endif // ERRORMESSAGE_PRJ_H_INCLUDED
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <stdint.h>
+#include "canhardware.h"
+
+/** \brief Cooperative main loop driven by events that interrupts post
+ *
+ * Interrupt handlers call Post(), the main loop collects all pending events
+ * with Take() and sleeps in WaitForEvent() when there is nothing left to do.
+ * Each event remembers the CPU cycle count of its first post, so the main loop
+ * can measure how long it took to service it.
+ */
+class EventLoop
+{
+   public:
+      enum Event { EV_SDO, EV_SAVE_CYCLES, EV_SAVE_STATS, EV_SAVE_STATE, EV_LAST };
+
+      static void Post(Event ev);
+      static uint32_t Take();
+      static bool IsSet(uint32_t events, Event ev) { return (events & (1 << ev)) != 0; }
+      static uint32_t GetPostTime(Event ev) { return postTime[ev]; }
+      static void WaitForEvent();
+      static uint32_t GetSleepTicks() { return sleepTicks; }
+
+   private:
+      static volatile uint32_t pending;
+      static volatile uint32_t postTime[EV_LAST];
+      static volatile uint32_t sleepTicks;
+};
+
+/** \brief Posts EV_SDO when an SDO request arrives
+ * The request itself is handled by CanSdo, which must be added to the
+ * CAN hardware first so the frame is pending when the main loop wakes up.
+ */
+class SdoEventSource: public CanCallback
+{
+   public:
+      SdoEventSource(CanHardware* hw) { hw->AddCallback(this); }
+      void HandleRx(uint32_t canId, uint32_t data[2], uint8_t dlc);
+      void HandleClear() {} //CanSdo registers the request id
+};
+
+#endif // EVENTLOOP_H
@@ -0,0 +1,57 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <stdint.h>
+
+/** \brief Wear levelled append-only record log in two flash pages
+ *
+ * Records are appended to the active page until it is full. Then the other
+ * page is erased and started with a snapshot record that replaces everything
+ * before it. So each page is only erased once per page worth of records.
+ *
+ * Every record is a header word (type << 16 | payload words), the payload and
+ * a CRC over both. The page header (magic and sequence number) is written
+ * last. A page whose snapshot was interrupted by a reset stays invalid and
+ * the previous page is used instead.
+ */
+class FlashLog
+{
+   public:
+      typedef void (*RecordHandler)(uint16_t type, const uint32_t* data, int words);
+
+      FlashLog(int blockNum);
+      bool Open(RecordHandler handler);
+      bool Append(uint16_t type, const uint32_t* data, int words);
+      void StartPage(uint16_t type, const uint32_t* data, int words);
+      int GetFreeWords();
+      uint32_t GetSequence() { return sequence; }
+
+   private:
+      uint32_t GetPageAddress(int page);
+      static int WriteRecord(uint32_t address, uint16_t type, const uint32_t* data, int words);
+
+      int firstBlock;
+      int activePage;
+      uint32_t sequence;
+      int offset; //next free word in active page
+};
+
+#endif // FLASHLOG_H
@@ -1,11 +1,16 @@
 #ifndef HWDEFS_H_INCLUDED
 #define HWDEFS_H_INCLUDED
 
-//Address of parameter block in flash
+//Address of parameter block in flash. Blocks are counted from the end of
+//flash, linker.ld must leave all of them out of the rom region
 #define FLASH_PAGE_SIZE 1024
 #define PARAM_BLKSIZE FLASH_PAGE_SIZE
 #define PARAM_BLKNUM  1   //last block of 1k
 #define CAN1_BLKNUM   2
+//Block 3 holds the boot loader pin definitions
+#define CYCLES_BLKNUM 4   //Cycle counter histogram
+#define STATS_BLKNUM  5   //Lifetime statistics log, also uses block 6
+#define STATE_BLKNUM  7   //Estimator state journal, also uses block 8
 
 enum HwRev { HW_UNKNOWN, HW_1X, HW_20, HW_21, HW_22, HW_23, HW_24 };
 
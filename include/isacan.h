@@ -0,0 +1,75 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ISACAN_H
+#define ISACAN_H
+
+#include <stdint.h>
+#include "canhardware.h"
+
+#define ISA_ID_CURRENT  0x521 //Result messages of the IVT-S, one per measured quantity
+#define ISA_ID_U1       0x522
+#define ISA_ID_U2       0x523
+#define ISA_ID_U3       0x524
+#define ISA_ID_TEMP     0x525
+#define ISA_ID_POWER    0x526
+#define ISA_ID_CHARGE   0x527
+#define ISA_ID_ENERGY   0x528
+
+/** \brief Receives the cyclic result messages of an IVT-S style CAN shunt
+ *
+ * Each result message carries a 4 bit message counter. The sensor increments
+ * it every cycle, so counter steps times the configured cycle time give the
+ * time between two current samples on the sensor's own clock. Missed frames
+ * and bus latency don't affect the integration.
+ */
+class IsaCan: public CanCallback
+{
+   public:
+      typedef void (*CurrentHandler)(float current, float dt);
+
+      IsaCan(CanHardware* hw);
+      void HandleRx(uint32_t canId, uint32_t data[2], uint8_t dlc);
+      void HandleClear();
+      void SetCurrentHandler(CurrentHandler h) { currentHandler = h; }
+      void SetCyclePeriod(uint16_t ms) { cyclePeriod = ms; }
+      float GetCurrent() { return current / 1000.0f; }
+      float GetVoltage(int chan) { return chan >= 0 && chan < 3 ? voltage[chan] / 1000.0f : 0; }
+      float GetTemperature() { return temperature / 10.0f; }
+      float GetPower() { return power; }
+      float GetCharge() { return charge; }
+      float GetEnergy() { return energy; }
+      uint32_t GetErrorFrames() { return errorFrames; }
+
+   private:
+      static int32_t GetValue(const uint32_t data[2]);
+
+      CanHardware* can;
+      CurrentHandler currentHandler;
+      uint16_t cyclePeriod;
+      int8_t lastCounter;
+      int32_t current; //mA
+      int32_t voltage[3]; //mV
+      int32_t temperature; //0.1 °C
+      int32_t power; //W
+      int32_t charge; //As
+      int32_t energy; //Wh
+      uint32_t errorFrames;
+};
+
+#endif // ISACAN_H
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JSONPRINTER_H
+#define JSONPRINTER_H
+
+#include <stdint.h>
+#include "cansdo.h"
+#include "canmap.h"
+
+/** \brief Prints the parameter list as JSON in resumable chunks
+ *
+ * Produces the same output as TerminalCommands::PrintParamsJson but returns
+ * after each parameter. The SDO print buffer only drains as fast as the client
+ * reads it, so printing everything at once would block the main loop for the
+ * whole dump. Between chunks the main loop can reply to other SDO requests.
+ */
+class JsonPrinter
+{
+   public:
+      static void SetCanMap(CanMap* m) { canMap = m; }
+      static void Start(IPutChar* out, bool printHidden);
+      static bool Run();
+      static bool IsBusy() { return output != 0; }
+
+   private:
+      static void PrintEntry(Param::PARAM_NUM idx);
+
+      static CanMap* canMap;
+      static IPutChar* output;
+      static uint16_t index;
+      static bool hidden;
+      static char comma;
+};
+
+#endif // JSONPRINTER_H
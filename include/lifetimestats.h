@@ -0,0 +1,82 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIFETIMESTATS_H
+#define LIFETIMESTATS_H
+
+#include <stdint.h>
+
+#define LS_CELLS          16
+#define LS_VOLTAGE_BINS   8
+#define LS_TEMP_BINS      8
+#define LS_BINS           (LS_CELLS * LS_VOLTAGE_BINS + LS_TEMP_BINS)
+#define LS_EXTREME_WORDS  3
+#define LS_DELTA_WORDS    (LS_EXTREME_WORDS + LS_BINS) //Largest possible delta record
+#define LS_SNAPSHOT_WORDS (LS_BINS + LS_EXTREME_WORDS)
+
+/** \brief Lifetime histograms of cell voltage and module temperature
+ *
+ * Counts the seconds each cell spent in each voltage bin and the module
+ * spent in each temperature bin. Also keeps the extreme cell voltages,
+ * temperatures and currents ever seen.
+ *
+ * Next to the totals every bin has a 16 bit counter of seconds since the
+ * last TakeDelta(). The delta record only lists changed bins, so appending
+ * it to flash costs a few words instead of the whole table. On start up
+ * the last snapshot and all later deltas are replayed with Load() and
+ * ApplyDelta().
+ */
+class LifetimeStats
+{
+   public:
+      enum Extreme { EX_UMIN, EX_UMAX, EX_TEMPMIN, EX_TEMPMAX, EX_IDCMIN, EX_IDCMAX, EX_LAST };
+      enum Record { REC_SNAPSHOT = 1, REC_DELTA };
+
+      static void AddCells(const float* voltages, int numCells, uint16_t seconds);
+      static void AddTemperature(float tempmin, float tempmax, uint16_t seconds);
+      static void AddCurrent(float current);
+      static uint32_t GetVoltageTime(int cell, int bin);
+      static uint32_t GetTemperatureTime(int bin);
+      static int32_t GetExtreme(Extreme e);
+      static int TakeDelta(uint32_t* record);
+      static bool ApplyDelta(const uint32_t* record, int words);
+      static void ClearDelta();
+      static bool Load(const uint32_t* snapshot, int words);
+      static const uint32_t* GetStorage() { return (const uint32_t*)&data; }
+      static int GetStorageWords() { return LS_SNAPSHOT_WORDS; }
+      static void Reset();
+
+   private:
+      struct Data
+      {
+         uint32_t time[LS_BINS]; //s, voltage bins of all cells followed by temperature bins
+         int16_t extremes[EX_LAST]; //mV, °C and A
+      };
+      static_assert(sizeof(Data) == LS_SNAPSHOT_WORDS * sizeof(uint32_t), "Snapshot size mismatch");
+
+      static int FindBin(const int16_t* edges, int numEdges, int value);
+      static void AddTime(int idx, uint16_t seconds);
+      static void UpdateExtremes(Extreme low, int16_t minValue, int16_t maxValue);
+
+      static Data data;
+      static uint16_t delta[LS_BINS];
+      static const int16_t voltageEdges[LS_VOLTAGE_BINS - 1];
+      static const int16_t tempEdges[LS_TEMP_BINS - 1];
+};
+
+#endif // LIFETIMESTATS_H
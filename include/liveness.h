@@ -0,0 +1,60 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <stdint.h>
+#include "bmsfsm.h"
+
+/** \brief Follows the 2 bit sequence counter and arrival time of each module PDO
+ *
+ * A counter step of one is a good frame, a step of two or three means frames
+ * were missed and no step means the frame was duplicated. A frame that arrives
+ * later than the heartbeat period plus some margin counts as late. A module
+ * that sends nothing for a given number of heartbeat periods is marked lost.
+ */
+class Liveness
+{
+   public:
+      enum Stat { RECEIVED, MISSED, DUPLICATE, LATE, LOST, MAXGAP, STAT_LAST };
+
+      static void Reset(uint8_t count, uint32_t periodMs, uint32_t timeMs);
+      static void Receive(uint8_t mod, uint8_t counter, uint32_t timeMs);
+      static void Readmit(uint8_t mod, uint32_t timeMs);
+      static int Run(uint32_t timeMs, uint8_t lostPeriods);
+      static uint16_t GetStat(uint8_t mod, Stat stat) { return mod < MAX_MODULES && stat < STAT_LAST ? modules[mod].stats[stat] : 0; }
+      static uint32_t GetTotal(Stat stat);
+      static uint32_t GetLostMask() { return lostMask; }
+
+   private:
+      struct Module
+      {
+         uint32_t lastRx;
+         uint8_t lastCounter;
+         bool seen;
+         uint16_t stats[STAT_LAST];
+      };
+
+      static Module modules[MAX_MODULES];
+      static uint32_t lostMask;
+      static uint32_t period;
+      static uint8_t numModules;
+};
+
+#endif // LIVENESS_H
@@ -0,0 +1,100 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MODULEDISC_H
+#define MODULEDISC_H
+
+#include <stdint.h>
+
+#ifndef MAX_MODULES
+#define MAX_MODULES 16 //master plus sub modules, can be overridden at compile time
+#endif
+
+#define DISC_ID_TOKEN        0x7dd //Address token passed down the enable chain
+#define DISC_ID_INFO_REQ     0x7de //Broadcast info request from the master
+#define DISC_ID_INFO_RESP    0x7c0 //+module index, info response
+#define DISC_ID_HELLO        0x7db //Restarted module asks to rejoin a running chain
+#define DISC_NO_INDEX        0xFF
+
+/* The module masks are 32 bit wide. Sub module PDOs at pdobase + 1 + index
+   must stay below the current frame at pdobase + 31 and the cell streams at
+   pdobase + 32 + index below the diagnostics at pdobase + 64. Info responses
+   must stay below the hello, token and info request ids. */
+static_assert(MAX_MODULES <= 16, "CAN ids of the modules would overlap");
+
+/** \brief Module enumeration protocol, independent of CAN hardware and FSM
+ *
+ * The master sends the address token to the first sub module. Every module
+ * repeats the token for the next module each cycle until it sees the next
+ * module forwarding it, so each module takes only about its boot time. Once
+ * no new token showed up for a while the master broadcasts one info request
+ * that all modules answer in their own response slot.
+ * A waiting module listens for a full cycle and takes the token with the highest
+ * index, the previous module might still be repeating its own token.
+ *
+ * A module that restarts in a running chain gets no token because its predecessor
+ * is done. It sends a hello with its cell count and the index it had before, if
+ * known. The master picks the index and sends a token on behalf of the predecessor.
+ * From there on the normal protocol continues, so modules behind it that restarted
+ * as well get their token from it.
+ */
+class ModuleDiscovery
+{
+   public:
+      enum State { WAIT_TOKEN, FORWARD_TOKEN, WAIT_CHAIN, COLLECT_INFO, DONE };
+
+      ModuleDiscovery();
+      void StartAsMaster(uint8_t nodeId, uint16_t pdobase, uint8_t numChan);
+      void StartAsSub(uint8_t numChan, uint8_t lastIndex);
+      bool Run(uint32_t& canId, uint32_t data[2]);
+      void HandleFrame(uint32_t canId, const uint32_t data[2]);
+      bool GetHello(uint8_t& cells, uint8_t& lastIndex);
+      void Admit(uint8_t mod);
+      static uint8_t ChooseRestartIndex(uint8_t prevIndex, uint32_t lostMask, uint8_t modules, bool appendDue);
+      State GetState() { return state; }
+      bool HasAddress() { return isMaster || state != WAIT_TOKEN; }
+      uint8_t GetNodeId() { return nodeId; }
+      uint8_t GetIndex() { return index; }
+      uint16_t GetPdoBase() { return pdobase; }
+      uint8_t GetNumModules() { return numModules; }
+      uint8_t GetCellsOfModule(uint8_t mod) { return mod < MAX_MODULES ? numChan[mod] : 0; }
+
+   private:
+      void MakeToken(uint32_t data[2], uint8_t tokenIndex);
+
+      State state;
+      bool isMaster;
+      bool infoRequested;
+      bool tokenSeen;
+      bool helloPending;
+      uint8_t nodeId;
+      uint8_t index;
+      uint16_t pdobase;
+      uint8_t cycles;
+      uint8_t retries;
+      uint8_t highestIndex;
+      uint8_t lastIndex; //Sub module: index before the restart, master: index from the pending hello
+      uint8_t helloCells;
+      uint8_t admitIndex;
+      uint8_t admitRepeat;
+      uint8_t numModules;
+      uint8_t numChan[MAX_MODULES];
+      uint32_t received; //Bit field of modules that answered the info request
+};
+
+#endif // MODULEDISC_H
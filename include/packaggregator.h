@@ -0,0 +1,71 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PACKAGGREGATOR_H
+#define PACKAGGREGATOR_H
+
+#include <stdint.h>
+#include "bmsfsm.h"
+
+/** \brief Keeps pack minimum, maximum and sum up to date as module data arrives
+ *
+ * Every module update only replaces that module's contribution. A full scan
+ * is only done when the module that held an extreme value moves away from it.
+ * Modules that haven't reported within the timeout are dropped from the
+ * result and reported as stale.
+ *
+ * All functions must run at the same interrupt priority or with interrupts
+ * masked. Update() briefly removes a module from the sum, CheckFreshness()
+ * must not drop it a second time in between.
+ */
+class PackAggregator
+{
+   public:
+      static void Reset(uint8_t modules, uint32_t timeMs);
+      static void Update(uint8_t mod, const ModuleData& data, uint32_t timeMs);
+      static void Readmit(uint8_t mod, uint32_t timeMs);
+      static int CheckFreshness(uint32_t timeMs, uint32_t timeoutMs);
+      static bool IsFresh(uint8_t mod) { return (freshMask >> mod) & 1; }
+      static uint32_t GetStaleMask() { return staleMask; }
+      static uint32_t GetAge(uint8_t mod, uint32_t timeMs) { return timeMs - lastRx[mod]; }
+      static uint16_t GetMin() { return umin; }
+      static uint16_t GetMax() { return umax; }
+      static uint32_t GetSum() { return sum; }
+      static uint16_t GetCells() { return cells; }
+      static float GetAverage() { return cells > 0 ? (float)sum / cells : 0; }
+      static int8_t GetTempMin() { return tempmin; }
+      static int8_t GetTempMax() { return tempmax; }
+
+   private:
+      static void Add(uint8_t mod);
+      static void Remove(uint8_t mod);
+      static void Rescan();
+
+      static ModuleData data[MAX_MODULES];
+      static uint32_t lastRx[MAX_MODULES];
+      static uint32_t freshMask;
+      static uint32_t staleMask;
+      static uint8_t numModules;
+      static uint32_t sum;
+      static uint16_t cells;
+      static uint16_t umin, umax;
+      static int8_t tempmin, tempmax;
+      static int8_t uminHolder, umaxHolder, tminHolder, tmaxHolder;
+};
+
+#endif // PACKAGGREGATOR_H
@@ -46,8 +46,10 @@
    2. Temporary parameters (id = 0)
    3. Display values
  */
-//Next param id (increase when adding new parameter!): 62
-//Next value Id: 2105
+/* ttarget reads -1 when the charge profile stops before the target SoC, tfull
+   reads -1 when no charge is possible at all. 0 means already there */
+//Next param id (increase when adding new parameter!): 86
+//Next value Id: 2141
 /*              category     name         unit       min     max     default id */
 #define PARAM_LIST \
     PARAM_ENTRY(CAT_BMS,     gain,        "mV/dig",  1,      1000,   586,    3   ) \
@@ -57,17 +59,29 @@
     PARAM_ENTRY(CAT_BMS,     numchan,     "",        1,      16,     16,     4   ) \
     PARAM_ENTRY(CAT_BMS,     balmode,     BALMODE,   0,      3,      0,      5   ) \
     PARAM_ENTRY(CAT_BMS,     ubalance,    "mV",      0,      4500,   4500,   30  ) \
+    PARAM_ENTRY(CAT_BMS,     ibalance,    "mA",      0,      1000,   100,    62  ) \
     PARAM_ENTRY(CAT_BMS,     idlewait,    "s",       0,      100000, 60,     12  ) \
     PARAM_ENTRY(CAT_BMS,     turnoffwait, "s",       0,      999999, 72000,  58  ) \
+    PARAM_ENTRY(CAT_BMS,     timingpol,   TIMINGPOL, 0,      1,      1,      84  ) \
+    PARAM_ENTRY(CAT_BMS,     lowpower,    OFFON,     0,      1,      1,      85  ) \
     PARAM_ENTRY(CAT_BMS,     idlethresh,  "A",       0,      10,     0.5,    55  ) \
     PARAM_ENTRY(CAT_BAT,     dischargemax,"A",       1,      2047,   200,    32  ) \
     PARAM_ENTRY(CAT_BAT,     nomcap,      "Ah",      0,      1000,   100,    9   ) \
     PARAM_ENTRY(CAT_BAT,     icc1,        "A",       1,      2000,   50,     43  ) \
-    PARAM_ENTRY(CAT_BAT,     icc2,        "A",       1,      2000,   30,     44  ) \
-    PARAM_ENTRY(CAT_BAT,     icc3,        "A",       1,      2000,   20,     45  ) \
+    PARAM_ENTRY(CAT_BAT,     icc2,        "A",       0,      2000,   30,     44  ) \
+    PARAM_ENTRY(CAT_BAT,     icc3,        "A",       0,      2000,   20,     45  ) \
+    PARAM_ENTRY(CAT_BAT,     icc4,        "A",       0,      2000,   0,      67  ) \
+    PARAM_ENTRY(CAT_BAT,     icc5,        "A",       0,      2000,   0,      68  ) \
     PARAM_ENTRY(CAT_BAT,     icutoff,     "A",       1,      200,    2,      57  ) \
     PARAM_ENTRY(CAT_BAT,     ucv1,        "mV",      3000,   4500,   3900,   46  ) \
     PARAM_ENTRY(CAT_BAT,     ucv2,        "mV",      3000,   4500,   4000,   47  ) \
+    PARAM_ENTRY(CAT_BAT,     ucv3,        "mV",      3000,   4500,   4100,   69  ) \
+    PARAM_ENTRY(CAT_BAT,     ucv4,        "mV",      3000,   4500,   4150,   70  ) \
+    PARAM_ENTRY(CAT_BAT,     tcc1,        "°C",      -40,    60,     -40,    71  ) \
+    PARAM_ENTRY(CAT_BAT,     tcc2,        "°C",      -40,    60,     -40,    72  ) \
+    PARAM_ENTRY(CAT_BAT,     tcc3,        "°C",      -40,    60,     -40,    73  ) \
+    PARAM_ENTRY(CAT_BAT,     tcc4,        "°C",      -40,    60,     -40,    74  ) \
+    PARAM_ENTRY(CAT_BAT,     tcc5,        "°C",      -40,    60,     -40,    75  ) \
     PARAM_ENTRY(CAT_BAT,     ucellmax,    "mV",      1000,   4500,   4200,   29  ) \
     PARAM_ENTRY(CAT_BAT,     ucellmin,    "mV",      1000,   4500,   3300,   28  ) \
     PARAM_ENTRY(CAT_BAT,     ucellhyst,   "mV",      1000,   4500,   4150,   56  ) \
@@ -84,15 +98,27 @@
     PARAM_ENTRY(CAT_BAT,     ucell80soc,  "mV",      2000,   4500,   4000,   25  ) \
     PARAM_ENTRY(CAT_BAT,     ucell90soc,  "mV",      2000,   4500,   4100,   26  ) \
     PARAM_ENTRY(CAT_BAT,     ucell100soc, "mV",      2000,   4500,   4200,   27  ) \
+    PARAM_ENTRY(CAT_BAT,     soctarget,   "%",       10,     100,    80,     76  ) \
     PARAM_ENTRY(CAT_BAT,     sohpreset,   "%",       10,     100,    100,    53  ) \
+    PARAM_ENTRY(CAT_BAT,     rcell,       "mOhm",    0.05,   100,    1,      63  ) \
+    PARAM_ENTRY(CAT_BAT,     cthcell,     "J/K",     10,     100000, 1000,   64  ) \
+    PARAM_ENTRY(CAT_BAT,     rthcell,     "K/W",     0.05,   100,    0.5,    65  ) \
+    PARAM_ENTRY(CAT_BAT,     tempmodel,   OFFON,     0,      1,      0,      66  ) \
     PARAM_ENTRY(CAT_SENS,    idcgain,     "dig/A",  -1000,   1000,   10,     6   ) \
     PARAM_ENTRY(CAT_SENS,    idcofs,      "dig",    -4095,   4095,   0,      7   ) \
     PARAM_ENTRY(CAT_SENS,    idcmode,     IDCMODES,  0,      3,      0,      8   ) \
+    PARAM_ENTRY(CAT_SENS,    isaperiod,   "ms",      1,      1000,   10,     83  ) \
     PARAM_ENTRY(CAT_SENS,    tempsns,     TEMPSNS,   0,      3,      0,      52  ) \
     PARAM_ENTRY(CAT_SENS,    tempres,     "Ohm",     10,     500000, 10000,  50  ) \
     PARAM_ENTRY(CAT_SENS,    tempbeta,    "",        1,      100000, 3900,   51  ) \
     PARAM_ENTRY(CAT_COMM,    pdobase,     "",        0,      2047,   500,    10  ) \
     PARAM_ENTRY(CAT_COMM,    sdobase,     "",        0,      63,     10,     11  ) \
+    PARAM_ENTRY(CAT_COMM,    modtimeout,  "ms",      500,    60000,  3000,   80  ) \
+    PARAM_ENTRY(CAT_COMM,    lostperiods, "",        1,      20,     3,      81  ) \
+    PARAM_ENTRY(CAT_COMM,    canperiod,   CANPERIODS,0,      1,      0,      79  ) \
+    PARAM_ENTRY(CAT_COMM,    cellsync,    OFFON,     0,      1,      1,      78  ) \
+    PARAM_ENTRY(CAT_COMM,    idcrate,     "Hz",      0,      200,    10,     82  ) \
+    PARAM_ENTRY(CAT_COMM,    cellfps,     "Hz",      0,      100,    10,     77  ) \
     TESTP_ENTRY(CAT_TEST,    enable,      OFFON,     0,      1,      1,      48  ) \
     TESTP_ENTRY(CAT_TEST,    testchan,    "",        -1,     15,     -1,     49  ) \
     TESTP_ENTRY(CAT_TEST,    testbalance, BALMODE,   0,      2,      0,      54  ) \
@@ -107,17 +133,36 @@
     VALUE_ENTRY(totalcells,  "",     2074 ) \
     VALUE_ENTRY(counter,     "",     2076 ) \
     VALUE_ENTRY(uptime,      "s",    2103 ) \
+    VALUE_ENTRY(syncskew,    "us",   2113 ) \
+    VALUE_ENTRY(stalemods,   "",     2114 ) \
+    VALUE_ENTRY(modlost,     "",     2115 ) \
+    VALUE_ENTRY(modrejoin,   "",     2120 ) \
+    VALUE_ENTRY(canmissed,   "",     2116 ) \
+    VALUE_ENTRY(candup,      "",     2117 ) \
+    VALUE_ENTRY(canlate,     "",     2118 ) \
+    VALUE_ENTRY(canqual,     "%",    2119 ) \
     VALUE_ENTRY(chargein,    "As",   2040 ) \
     VALUE_ENTRY(chargeout,   "As",   2041 ) \
+    VALUE_ENTRY(energyin,    "kWh",  2139 ) \
+    VALUE_ENTRY(energyout,   "kWh",  2140 ) \
     VALUE_ENTRY(soc,         "%",    2071 ) \
     VALUE_ENTRY(soh,         "%",    2086 ) \
+    VALUE_ENTRY(efc,         "",     2107 ) \
+    VALUE_ENTRY(ahthrough,   "Ah",   2108 ) \
+    VALUE_ENTRY(ttarget,     "min",  2110 ) \
+    VALUE_ENTRY(tfull,       "min",  2111 ) \
+    VALUE_ENTRY(tempty,      "min",  2112 ) \
     VALUE_ENTRY(chargelim,   "A",    2072 ) \
     VALUE_ENTRY(dischargelim,"A",    2073 ) \
     VALUE_ENTRY(idc,         "A",    2042 ) \
     VALUE_ENTRY(idcavg,      "A",    2043 ) \
+    VALUE_ENTRY(isau1,       "V",    2121 ) \
+    VALUE_ENTRY(isaah,       "Ah",   2122 ) \
+    VALUE_ENTRY(isakwh,      "kWh",  2123 ) \
     VALUE_ENTRY(power,       "W",    2075 ) \
     VALUE_ENTRY(tempmin,     "°C",   2044 ) \
     VALUE_ENTRY(tempmax,     "°C",   2077 ) \
+    VALUE_ENTRY(tcoremax,    "°C",   2109 ) \
     VALUE_ENTRY(uavg,        "mV",   2002 ) \
     VALUE_ENTRY(umin,        "mV",   2003 ) \
     VALUE_ENTRY(umax,        "mV",   2004 ) \
@@ -144,41 +189,6 @@
     VALUE_ENTRY(umax0,       "mV",   2049 ) \
     VALUE_ENTRY(tempmin0,    "°C",   2078 ) \
     VALUE_ENTRY(tempmax0,    "°C",   2079 ) \
-    VALUE_ENTRY(uavg1,       "mV",   2050 ) \
-    VALUE_ENTRY(umin1,       "mV",   2051 ) \
-    VALUE_ENTRY(umax1,       "mV",   2052 ) \
-    VALUE_ENTRY(tempmin1,    "°C",   2087 ) \
-    VALUE_ENTRY(tempmax1,    "°C",   2088 ) \
-    VALUE_ENTRY(uavg2,       "mV",   2053 ) \
-    VALUE_ENTRY(umin2,       "mV",   2054 ) \
-    VALUE_ENTRY(umax2,       "mV",   2055 ) \
-    VALUE_ENTRY(tempmin2,    "°C",   2089 ) \
-    VALUE_ENTRY(tempmax2,    "°C",   2090 ) \
-    VALUE_ENTRY(uavg3,       "mV",   2056 ) \
-    VALUE_ENTRY(umin3,       "mV",   2057 ) \
-    VALUE_ENTRY(umax3,       "mV",   2058 ) \
-    VALUE_ENTRY(tempmin3,    "°C",   2091 ) \
-    VALUE_ENTRY(tempmax3,    "°C",   2092 ) \
-    VALUE_ENTRY(uavg4,       "mV",   2059 ) \
-    VALUE_ENTRY(umin4,       "mV",   2060 ) \
-    VALUE_ENTRY(umax4,       "mV",   2061 ) \
-    VALUE_ENTRY(tempmin4,    "°C",   2093 ) \
-    VALUE_ENTRY(tempmax4,    "°C",   2094 ) \
-    VALUE_ENTRY(uavg5,       "mV",   2062 ) \
-    VALUE_ENTRY(umin5,       "mV",   2063 ) \
-    VALUE_ENTRY(umax5,       "mV",   2064 ) \
-    VALUE_ENTRY(tempmin5,    "°C",   2095 ) \
-    VALUE_ENTRY(tempmax5,    "°C",   2096 ) \
-    VALUE_ENTRY(uavg6,       "mV",   2065 ) \
-    VALUE_ENTRY(umin6,       "mV",   2066 ) \
-    VALUE_ENTRY(umax6,       "mV",   2067 ) \
-    VALUE_ENTRY(tempmin6,    "°C",   2097 ) \
-    VALUE_ENTRY(tempmax6,    "°C",   2098 ) \
-    VALUE_ENTRY(uavg7,       "mV",   2068 ) \
-    VALUE_ENTRY(umin7,       "mV",   2069 ) \
-    VALUE_ENTRY(umax7,       "mV",   2070 ) \
-    VALUE_ENTRY(tempmin7,    "°C",   2099 ) \
-    VALUE_ENTRY(tempmax7,    "°C",   2100 ) \
     VALUE_ENTRY(u0cmd,       BAL,    2022 ) \
     VALUE_ENTRY(u1cmd,       BAL,    2023 ) \
     VALUE_ENTRY(u2cmd,       BAL,    2024 ) \
@@ -195,7 +205,24 @@
     VALUE_ENTRY(u13cmd,      BAL,    2035 ) \
     VALUE_ENTRY(u14cmd,      BAL,    2036 ) \
     VALUE_ENTRY(u15cmd,      BAL,    2037 ) \
-    VALUE_ENTRY(cpuload,     "%",    2038 )
+    VALUE_ENTRY(sdleakmax,   "mA",   2105 ) \
+    VALUE_ENTRY(sdcell,      "",     2106 ) \
+    VALUE_ENTRY(cpuload,     "%",    2038 ) \
+    VALUE_ENTRY(cpuduty,     "%",    2135 ) \
+    VALUE_ENTRY(sdolat,      "us",   2136 ) \
+    VALUE_ENTRY(sdolatmax,   "us",   2137 ) \
+    VALUE_ENTRY(sdolatjson,  "us",   2138 ) \
+    VALUE_ENTRY(tms5avg,     "us",   2124 ) \
+    VALUE_ENTRY(tms5max,     "us",   2125 ) \
+    VALUE_ENTRY(tcellavg,    "us",   2126 ) \
+    VALUE_ENTRY(tcellmax,    "us",   2127 ) \
+    VALUE_ENTRY(tmuxavg,     "us",   2128 ) \
+    VALUE_ENTRY(tmuxmax,     "us",   2129 ) \
+    VALUE_ENTRY(tms100avg,   "us",   2130 ) \
+    VALUE_ENTRY(tms100max,   "us",   2131 ) \
+    VALUE_ENTRY(tlate,       "",     2132 ) \
+    VALUE_ENTRY(toverrun,    "",     2133 ) \
+    VALUE_ENTRY(tdiscard,    "",     2134 )
 
 
 /***** Enum String definitions *****/
@@ -206,6 +233,8 @@
 #define BAL          "0=None, 1=Discharge, 2=ChargePos, 3=ChargeNeg"
 #define IDCMODES     "0=Off, 1=AdcSingle, 2=AdcDifferential, 3=IsaCan"
 #define TEMPSNS      "0=None, 1=Chan1, 2=Chan2, 3=Both"
+#define CANPERIODS   "0=100ms, 1=10ms"
+#define TIMINGPOL    "0=Count, 1=Discard"
 #define CAT_TEST     "Testing"
 #define CAT_BMS      "BMS"
 #define CAT_SENS     "Sensor setup"
@@ -239,6 +268,12 @@ enum _canspeeds
    CAN_PERIOD_LAST
 };
 
+enum _timingpol
+{
+   TIMING_COUNT = 0,
+   TIMING_DISCARD
+};
+
 enum _balmode
 {
    BAL_OFF = 0,
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PDOSCHEDULER_H
+#define PDOSCHEDULER_H
+
+#include <stdint.h>
+#include "params.h"
+#include "canhardware.h"
+
+#define PDO_MAX_MESSAGES 4
+#define PDO_MAX_FIELDS   6
+
+/** \brief Sends the internal PDOs at individual rates and only when their content changed
+ *
+ * Each message is checked at its period. It is sent when any field moved
+ * further than its deadband since it was last sent, or when it has been
+ * silent for the maximum silence interval. Each message carries its own
+ * 2 bit sequence counter so receivers can detect lost frames.
+ */
+class PdoScheduler
+{
+   public:
+      enum Period { PERIOD_10MS = 1, PERIOD_100MS = 10, PERIOD_1S = 100 };
+
+      static void Clear();
+      static int AddMessage(uint32_t canId, Period period, uint16_t maxSilenceMs, uint8_t counterOffset);
+      static bool AddField(int msg, Param::PARAM_NUM param, uint8_t offset, uint8_t length, float gain, float deadband);
+      static void Run(CanHardware* can);
+
+   private:
+      struct Field
+      {
+         Param::PARAM_NUM param;
+         uint8_t offset;
+         uint8_t length;
+         float gain;
+         float deadband;
+         float lastValue;
+      };
+
+      struct Message
+      {
+         uint32_t canId;
+         uint8_t period;
+         uint8_t numFields;
+         uint8_t counterOffset;
+         uint8_t counter;
+         uint16_t maxSilence;
+         uint16_t silence;
+         Field fields[PDO_MAX_FIELDS];
+      };
+
+      static Message messages[PDO_MAX_MESSAGES];
+      static int numMessages;
+      static uint32_t ticks;
+};
+
+#endif // PDOSCHEDULER_H
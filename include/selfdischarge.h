@@ -0,0 +1,57 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SELFDISCHARGE_H
+#define SELFDISCHARGE_H
+
+#include <stdint.h>
+
+#define SD_MAX_CELLS 16
+
+class SelfDischarge
+{
+   public:
+      static bool Run(uint32_t timeSec, bool resting);
+      static void AddSample(uint32_t timeSec, const float* voltages, int numCells);
+      static void AddBalancingCharge(int cell, float charge);
+      static void SetNominalCapacity(float c) { nominalCapacity = c; }
+      static float GetLeakageCurrent(int cell) { return cell < SD_MAX_CELLS ? leakage[cell] : 0; }
+      static int GetWorstCell();
+      static bool IsValid() { return valid; }
+
+   private:
+      static void StartRest(uint32_t timeSec);
+      static void UpdateEstimate();
+      static float CalculateVoltagePerCharge(float voltage);
+
+      static float nominalCapacity;
+      static float leakage[SD_MAX_CELLS];
+      static float lastLeakage[SD_MAX_CELLS];
+      static float meanU[SD_MAX_CELLS];
+      static float covTU[SD_MAX_CELLS];
+      static float balanceCharge[SD_MAX_CELLS];
+      static float meanT, varT;
+      static float voltagePerCharge;
+      static uint32_t restStart, lastSample;
+      static int numSamples;
+      static int cellCount;
+      static bool resting;
+      static bool valid, lastValid;
+};
+
+#endif // SELFDISCHARGE_H
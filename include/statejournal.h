@@ -0,0 +1,66 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STATEJOURNAL_H
+#define STATEJOURNAL_H
+
+#include <stdint.h>
+
+#define JOURNAL_MAGIC          0xA5
+#define JOURNAL_VERSION        2
+#define JOURNAL_BACKUP_WORDS   7 //16 bit backup registers BKP_DR4 to BKP_DR10
+#define JOURNAL_RECORD_WORDS   9 //version, sequence and the State fields
+
+/** \brief Estimator and counter state that must survive resets and power loss
+ *
+ * The complete state goes into a flash journal record. Flash is only written
+ * every few minutes and on state changes, so the charge counted since the last
+ * record is kept in the battery backed registers, which are cheap to update
+ * every second. A backup block is bound to its flash record by the record's
+ * sequence number. After power loss without VBAT the backup block is invalid
+ * and only the flash record is restored.
+ *
+ * Both formats carry the version number and a CRC. Blocks with another
+ * version are discarded instead of being misinterpreted.
+ */
+class StateJournal
+{
+   public:
+      struct State
+      {
+         float chargeIn; //As
+         float chargeOut; //As
+         float energyIn; //kWh
+         float energyOut; //kWh
+         float estimatedSoc; //%, the SoC the integration in RUN starts from
+         float estimatedSocAtValidSoh; //%
+         float asDiffAfterEstimate; //As
+      };
+
+      enum Record { REC_STATE = 1 };
+
+      static void EncodeRecord(const State& s, uint16_t sequence, uint32_t* record);
+      static bool DecodeRecord(const uint32_t* record, int words, State& s, uint16_t& sequence);
+      static void EncodeBackup(const State& s, const State& saved, uint16_t sequence, uint16_t* regs);
+      static bool DecodeBackup(const uint16_t* regs, uint16_t sequence, State& s);
+
+   private:
+      static uint16_t Crc16(const uint16_t* data, int len);
+};
+
+#endif // STATEJOURNAL_H
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TASKPROFILER_H
+#define TASKPROFILER_H
+
+#include <stdint.h>
+
+#define TASKPROF_MAX_TASKS 4
+#define TASKPROF_JITTER_BINS 8
+
+#ifdef STM32F1
+#include "timebase.h"
+#else
+#include <chrono>
+#define TIMEBASE_CYCLES_PER_US 72 //Host builds count in equivalent 72 MHz cycles
+#endif
+
+/** \brief Measures the execution time of scheduler tasks
+ *
+ * Wrap the task function when adding it to the scheduler:
+ * s.AddTask(TaskProfiler::Run<MyTask, 0>, 10);
+ * On the target the DWT cycle counter is used, host builds use a steady clock.
+ *
+ * Tasks with a deadline also get their start jitter checked. The deviation
+ * from the nominal period goes into a histogram, starts later than the
+ * tolerance count as late and runs longer than the period as overrun. Both
+ * set a sticky violation flag that consumers of timing sensitive results
+ * can check with CheckViolation().
+ */
+class TaskProfiler
+{
+   public:
+      enum Stat { MIN, AVG, MAX, CALLS, LATE, OVERRUN, STAT_LAST };
+
+      template <void (*task)(void), int idx>
+      static void Run()
+      {
+         uint32_t start = GetCycles();
+         CheckStart(idx, start);
+         task();
+         Record(idx, GetCycles() - start);
+      }
+
+      static void SetDeadline(int idx, uint32_t periodMs, uint32_t toleranceUs);
+      static void CheckStart(int idx, uint32_t start);
+      static void Record(int idx, uint32_t cycles);
+      static bool CheckViolation(int idx);
+      static uint32_t GetStat(int idx, Stat stat);
+      static uint32_t GetJitterCount(int idx, int bin);
+      static float GetMicros(int idx, Stat stat) { return GetStat(idx, stat) / (float)TIMEBASE_CYCLES_PER_US; }
+      static void Reset();
+
+   private:
+      struct Stats
+      {
+         uint32_t min;
+         uint32_t max;
+         uint32_t calls;
+         uint64_t sum;
+         uint32_t late;
+         uint32_t overrun;
+         uint32_t lastStart;
+         uint32_t jitter[TASKPROF_JITTER_BINS];
+      };
+
+      struct Deadline
+      {
+         uint32_t period; //cycles, 0 means no deadline
+         uint32_t tolerance;
+         volatile bool violated;
+      };
+
+#ifdef STM32F1
+      static uint32_t GetCycles() { return TimeBase::GetCycles(); }
+#else
+      static uint32_t GetCycles()
+      {
+         std::chrono::nanoseconds ns = std::chrono::steady_clock::now().time_since_epoch();
+         return (uint64_t)ns.count() * TIMEBASE_CYCLES_PER_US / 1000;
+      }
+#endif
+
+      static Stats stats[TASKPROF_MAX_TASKS];
+      static Deadline deadlines[TASKPROF_MAX_TASKS];
+      static const uint16_t jitterBins[TASKPROF_JITTER_BINS - 1];
+};
+
+#endif // TASKPROFILER_H
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef THERMALMODEL_H
+#define THERMALMODEL_H
+
+/** \brief Lumped single node thermal model of the cell core in one module
+ *
+ * The core is heated by I^2*R and loses heat to the cell surface via a
+ * thermal resistance. The surface is no second model node, its temperature
+ * is the boundary condition and comes from the NTC measurement. So the
+ * model only predicts how far the core runs ahead of the surface, in steady
+ * state by I^2*R*Rth with the time constant Rth*Cth.
+ */
+class ThermalModel
+{
+   public:
+      ThermalModel() : coreTemp(0), initialized(false) {}
+      float Run(float current, float surfaceTemp);
+      float GetCoreTemperature() { return coreTemp; }
+      void Reset() { initialized = false; }
+      static void SetCellParameters(float resistance, float heatCapacity, float thermalResistance);
+      static void SetCallingFrequency(int f) { timeStep = 1.0f / f; }
+
+   private:
+      float coreTemp;
+      bool initialized;
+
+      static float cellResistance;
+      static float cellHeatCapacity;
+      static float cellThermalResistance;
+      static float timeStep;
+};
+
+#endif // THERMALMODEL_H
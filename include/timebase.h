@@ -0,0 +1,58 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+#include <libopencm3/cm3/dwt.h>
+#include <libopencm3/cm3/systick.h>
+
+#define TIMEBASE_CYCLES_PER_US 72
+#define TIMEBASE_TICK_MASK     0xFFFFFF //SysTick is a 24 bit counter
+
+/** \brief Free running high resolution time stamps from the DWT cycle counter
+ * The counter wraps after about 59 s at 72 MHz, so only use it for differences.
+ * For longer intervals there is a millisecond counter advanced by the 5 ms task.
+ *
+ * The cycle counter runs on the core clock, which stops in sleep mode. Ticks
+ * come from SysTick at 9 MHz, it runs on the free running FCLK and keeps counting
+ * while the CPU sleeps in WFI. They wrap after about 1.8 s.
+ */
+class TimeBase
+{
+   public:
+      static void Init()
+      {
+         dwt_enable_cycle_counter();
+         systick_set_clocksource(STK_CSR_CLKSOURCE_AHB_DIV8);
+         systick_set_reload(TIMEBASE_TICK_MASK);
+         systick_counter_enable();
+      }
+      static uint32_t GetCycles() { return dwt_read_cycle_counter(); }
+      /** \brief Counts up, only use differences masked with TIMEBASE_TICK_MASK */
+      static uint32_t GetTicks() { return ~systick_get_value() & TIMEBASE_TICK_MASK; }
+      static uint32_t CyclesToMicros(uint32_t cycles) { return cycles / TIMEBASE_CYCLES_PER_US; }
+      static void Tick(uint32_t ms) { millis += ms; }
+      static uint32_t GetMillis() { return millis; }
+
+   private:
+      static volatile uint32_t millis;
+};
+
+#endif // TIMEBASE_H
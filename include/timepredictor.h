@@ -0,0 +1,50 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIMEPREDICTOR_H
+#define TIMEPREDICTOR_H
+
+#include <stdint.h>
+
+#define TIME_UNREACHABLE -1 //Time to target or full when the charge stops before
+
+class TimePredictor
+{
+   public:
+      static void Run(float soc, float lowTemp, float derating);
+      static void SetTarget(float soc);
+      static void SetCapacity(float ah);
+      static void SetCellResistance(float r);
+      static void SetCutoffCurrent(float i);
+      static void Invalidate() { restart = true; }
+      static float GetTimeToTarget() { return timeToTarget; }
+      static float GetTimeToFull() { return timeToFull; }
+      static float CalculateTimeToEmpty(float soc, float power, int numCells);
+
+   private:
+      static void Start(float soc, float lowTemp, float derating);
+      static bool Step();
+
+      static float targetSoc, capacity, resistance, cutoffCurrent;
+      static float startSoc, startTemp, startDerating;
+      static float simSoc, simTime, simTimeToTarget;
+      static float timeToTarget, timeToFull;
+      static bool restart, running;
+};
+
+#endif // TIMEPREDICTOR_H
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_SIZE  64 //Number of records, must be a power of 2
+#define TRACE_WORDS 3  //32 bit words per record when read over SDO
+
+/** \brief RAM ring buffer of compact binary event records
+ *
+ * Add() can be called from any task or interrupt. It claims a slot with an
+ * atomic increment and publishes the record by writing its type last, so
+ * readers skip records that are still being written. When full the oldest
+ * record is overwritten.
+ *
+ * Each record holds the cycle counter for fine timing and the millisecond
+ * counter for coarse timing, both taken on the target's time base. The
+ * buffer is read one word at a time over SDO, freeze it first to get a
+ * consistent snapshot. tracedecode.py turns the words into readable text.
+ */
+class Trace
+{
+   public:
+      //Don't reorder, tracedecode.py uses the same numbers
+      enum Type { TR_NONE, TR_STATE, TR_BALANCE, TR_SELFTEST, TR_LIMIT, TR_I2C, TR_LAST };
+
+      static void Add(Type type, uint8_t arg8, int16_t arg16);
+      static bool GetWord(uint32_t record, int word, uint32_t& value);
+      static uint32_t GetCount() { return head; }
+      static uint32_t GetDropped() { return dropped; }
+      static void Freeze(bool f) { frozen = f; }
+      static void Clear();
+
+   private:
+      struct Record
+      {
+         uint32_t cycles;
+         uint32_t millis;
+         uint8_t type;
+         uint8_t arg8;
+         int16_t arg16;
+      };
+
+      static Record records[TRACE_SIZE];
+      static volatile uint32_t head;
+      static volatile uint32_t dropped;
+      static volatile bool frozen;
+};
+
+#endif // TRACE_H
@@ -19,10 +19,15 @@
 #include "bmsalgo.h"
 #include "my_math.h"
 
+#define STAGE_HYSTERESIS 20 //Fall back to the previous stage when this many mV below its target
+
 float BmsAlgo::nominalCapacity;
 //voltage to state of charge            0%    10%   20%   30%   40%   50%   60%   70%   80%   90%   100%
 uint16_t BmsAlgo::voltageToSoc[] =    { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
-PiControllerFloat BmsAlgo::cvControllers[3];
+BmsAlgo::ChargeStage BmsAlgo::stages[MAX_CHARGE_STAGES];
+int BmsAlgo::numStages = 1;
+int BmsAlgo::activeStage = 0;
+float BmsAlgo::chargeCurrent = 0;
 PiControllerFloat BmsAlgo::cellMinController;
 bool BmsAlgo::full;
 
@@ -76,56 +81,83 @@ float BmsAlgo::EstimateSocFromVoltage(float lowestVoltage)
    return 100;
 }
 
+/** \brief Looks up the open circuit voltage at a given SoC, inverse of EstimateSocFromVoltage()
+ *
+ * \param soc state of charge in %
+ * \return open circuit voltage in mV
+ *
+ */
+float BmsAlgo::EstimateVoltageFromSoc(float soc)
+{
+   if (soc <= 0) return voltageToSoc[0];
+   if (soc >= 100) return voltageToSoc[10];
+
+   int idx = soc / 10;
+   float frac = (soc - idx * 10) / 10;
+
+   return voltageToSoc[idx] + (voltageToSoc[idx + 1] - voltageToSoc[idx]) * frac;
+}
+
 /**
  * @brief Calculates the charge current for a battery based on the maximum cell voltage.
  *
- * This function determines the appropriate charge current for a battery by evaluating
- * the difference between predefined voltage levels and the maximum cell voltage.
- * It implements a three-stage Constant Current-Constant Voltage (CC-CV) charging
- * strategy, where each stage has its own target voltage and corresponding maximum
- * charge current.
+ * The charge profile consists of up to MAX_CHARGE_STAGES consecutive CC/CV stages.
+ * Each stage charges with its constant current until the maximum cell voltage
+ * reaches the stage voltage target, then the stage controller reduces the current.
+ * Once the current has dropped to the constant current of the following stage
+ * that stage takes over. Its integrator is preloaded with the current output, so
+ * the hand-over is bumpless. Only the controller of the active stage is evaluated.
  *
- * The function computes the charge current for three stages:
- * - The first stage uses a gain factor to calculate the charge current based on the
- *   difference between the first target voltage and the maximum cell voltage.
- * - The second stage calculates the charge current similarly, using the second target
- *   voltage.
- * - The third stage follows the same approach with the third target voltage.
- *
- * The results from each stage are capped to ensure they do not exceed the defined
- * maximum charge currents and are non-negative. The final charge current is determined
- * by taking the maximum value from the three stages.
+ * A stage is only allowed when the lowest cell temperature is within its window,
+ * otherwise charging continues with the next (lower current) stage.
+ * When the cell voltage relaxes below the target of the previous stage, e.g. because
+ * charging was interrupted, we fall back to that stage.
  *
  * @param maxCellVoltage The maximum voltage of the battery cell, expressed as a float.
+ * @param hystVoltage Charging restarts once the battery was full and maxCellVoltage dropped below this
+ * @param icutoff Battery is considered full when the current drops below this
+ * @param lowTemp lowest cell temperature in °C
  *
  * @return The calculated charge current for the battery as a float.
  *         The result is capped to ensure it does not exceed the defined current limits
  *         and is non-negative.
  */
-float BmsAlgo::GetChargeCurrent(float maxCellVoltage, float hystVoltage, float icutoff)
+float BmsAlgo::GetChargeCurrent(float maxCellVoltage, float hystVoltage, float icutoff, float lowTemp)
 {
-   float result;
+   if (full)
+   {
+      if (maxCellVoltage >= hystVoltage) return 0;
 
-   /* Here we try to mimic VWs charge curve for a warm battery.
-    *
-    * We run 3 subsequent CC-CV curves
-    * 1st starts at cc1Current and aims for cv1Voltage
-    * 2nd starts at cc2Current and aims for cv2Voltage
-    * 3rd starts at cc3Current and aims for cv3Voltage
-    *
-    */
+      //Cells have relaxed enough to start a new charge
+      full = false;
+      EnterStage(0, 0);
+   }
 
-   float cv1Result = cvControllers[0].Run(maxCellVoltage);
-   float cv2Result = cvControllers[1].Run(maxCellVoltage);
-   float cv3Result = cvControllers[2].Run(maxCellVoltage);
+   while (activeStage > 0 && StageAllowed(activeStage - 1, lowTemp) &&
+          maxCellVoltage < (stages[activeStage - 1].controller.GetRef() - STAGE_HYSTERESIS))
+      EnterStage(activeStage - 1, chargeCurrent);
 
-   result = MAX(cv1Result, MAX(cv2Result, cv3Result));
+   while (activeStage < (numStages - 1) && !StageAllowed(activeStage, lowTemp))
+      EnterStage(activeStage + 1, stages[activeStage + 1].current);
 
-   if (result < icutoff)
-      full = true;
+   if (!StageAllowed(activeStage, lowTemp))
+   {
+      chargeCurrent = 0;
+      return 0;
+   }
 
-   if (maxCellVoltage < hystVoltage)
-      full = false;
+   float result = stages[activeStage].controller.Run(maxCellVoltage);
+
+   while (activeStage < (numStages - 1) && result <= stages[activeStage + 1].current)
+   {
+      EnterStage(activeStage + 1, result);
+      result = stages[activeStage].controller.Run(maxCellVoltage);
+   }
+
+   chargeCurrent = result;
+
+   if (result < icutoff && maxCellVoltage >= hystVoltage)
+      full = true;
 
    return full ? 0 : result;
 }
@@ -222,25 +254,66 @@ void BmsAlgo::SetSocLookupPoint(uint8_t soc, uint16_t voltage)
    voltageToSoc[soc / 10] = voltage;
 }
 
-/** \brief Sets a charge current curve.
+/** \brief Calculates the steady state current of the charge profile at a given SoC
  *
- * The overall charge curve is determined by 3 consecutive CC/CV curves
- * charging starts with CC1 and aims for CV1
- * Once the current drop below the CC value of curve 2 CC/CV curve 2 becomes active
- * Likewise for curve 3
+ * Other than GetChargeCurrent() this doesn't touch the controllers. It assumes
+ * each stage either runs at its constant current or holds the cell exactly at
+ * its voltage target, which is what the controllers settle to.
  *
- * \param idx Index of CC/CV curve 0, 1, 2
+ * \param soc state of charge in %
+ * \param resistance internal cell resistance in mOhm
+ * \param lowTemp lowest cell temperature in °C
+ * \return charge current in A
+ *
+ */
+float BmsAlgo::GetProfileCurrent(float soc, float resistance, float lowTemp)
+{
+   float ocv = EstimateVoltageFromSoc(soc);
+   float result = 0;
+
+   for (int i = 0; i < numStages; i++)
+   {
+      if (!StageAllowed(i, lowTemp)) continue;
+
+      float cvCurrent = (stages[i].controller.GetRef() - ocv) / resistance;
+      result = MAX(result, MIN(stages[i].current, cvCurrent));
+   }
+   return result;
+}
+
+/** \brief Configures one stage of the charge profile.
+ *
+ * Charging starts with stage 0 and aims for its voltage target.
+ * Once the current drops below the current of stage 1 that stage becomes active.
+ * Likewise for all following stages.
+ *
+ * \param idx Index of stage 0..MAX_CHARGE_STAGES-1
  * \param current Constant current value
  * \param voltage voltage target
+ * \param minTemp lowest cell temperature at which this stage may be used
  *
  */
-void BmsAlgo::SetCCCVCurve(uint8_t idx, float current, uint16_t voltage)
+void BmsAlgo::SetChargeStage(uint8_t idx, float current, uint16_t voltage, float minTemp)
 {
-   if (idx > 2) return;
+   if (idx >= MAX_CHARGE_STAGES) return;
 
-   cvControllers[idx].SetRef(voltage);
-   cvControllers[idx].SetMinMaxY(0, current);
-   cvControllers[idx].ResetIntegrator();
+   stages[idx].controller.SetRef(voltage);
+   stages[idx].controller.SetMinMaxY(0, current);
+   stages[idx].controller.ResetIntegrator();
+   stages[idx].current = current;
+   stages[idx].minTemp = minTemp;
+   activeStage = 0;
+}
+
+/** \brief Sets the number of used stages of the charge profile
+ *
+ * \param num number of stages, 1..MAX_CHARGE_STAGES
+ *
+ */
+void BmsAlgo::SetNumChargeStages(uint8_t num)
+{
+   numStages = MAX(1, MIN(num, MAX_CHARGE_STAGES));
+   activeStage = 0;
 }
 
 /** \brief Set the minimum cell voltage limit
@@ -266,20 +339,23 @@ void BmsAlgo::SetMinVoltage(uint32_t voltage, float maxCurrent)
  */
 void BmsAlgo::SetControllerGains(float kp, float ki)
 {
-   cvControllers[0].SetGains(kp, ki);
-   cvControllers[0].SetCallingFrequency(10);
-   cvControllers[0].ResetIntegrator();
-   cvControllers[1].SetGains(kp, ki);
-   cvControllers[1].SetCallingFrequency(10);
-   cvControllers[1].ResetIntegrator();
-   cvControllers[2].SetGains(kp, ki);
-   cvControllers[2].SetCallingFrequency(10);
-   cvControllers[2].ResetIntegrator();
+   for (int i = 0; i < MAX_CHARGE_STAGES; i++)
+   {
+      stages[i].controller.SetGains(kp, ki);
+      stages[i].controller.SetCallingFrequency(10);
+      stages[i].controller.ResetIntegrator();
+   }
    cellMinController.SetGains(kp, ki);
    cellMinController.SetCallingFrequency(10);
    cellMinController.ResetIntegrator();
 }
 
+void BmsAlgo::EnterStage(int idx, float startCurrent)
+{
+   activeStage = idx;
+   stages[idx].controller.PreloadIntegrator(startCurrent);
+}
+
 /**
  * @brief Calculates the State of Health (SoH) of a battery based on the
  *        last and new State of Charge (SoC) values and the actual difference.
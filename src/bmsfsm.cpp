@@ -16,28 +16,37 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <libopencm3/stm32/f1/bkp.h>
+#include <libopencm3/cm3/cortex.h>
 #include "bmsfsm.h"
 #include "anain.h"
 #include "digio.h"
 #include "my_math.h"
 #include "flyingadcbms.h"
 #include "selftest.h"
+#include "cellstream.h"
+#include "bmsio.h"
+#include "pdoscheduler.h"
+#include "packaggregator.h"
+#include "liveness.h"
+#include "currentframe.h"
+#include "timebase.h"
 
 #define IS_FIRST_THRESH       1800
 #define IS_ENABLED_THRESH     500
-#define SDO_INDEX_PARAMS      0x2000
-#define BOOT_DELAY_CYCLES     5
+#define INDEX_HINT_MAGIC      0xA500 //Marks a valid module index in BKP_DR3
 
 BmsFsm::BmsFsm(CanMap* cm, CanSdo* cs)
-   : canMap(cm), canSdo(cs), isMain(false), infoIndex(1), numModules(1), cycles(0)
+   : canMap(cm), canSdo(cs), isMain(false), numModules(1), cycles(0), helloCycles(0), syncCounter(0)
 {
    cm->GetHardware()->AddCallback(this);
    HandleClear();
-   recvNodeId = Param::GetInt(Param::sdobase);
    pdobase = Param::GetInt(Param::pdobase);
-   ourNodeId = recvNodeId;
+   ourNodeId = Param::GetInt(Param::sdobase);
    ourIndex = 0;
-   recvIndex = 0;
+
+   for (int i = 0; i < MAX_MODULES; i++)
+      modules[i] = ModuleData();
 }
 
 /**
@@ -51,10 +60,10 @@ BmsFsm::BmsFsm(CanMap* cm, CanSdo* cs)
  *
  * The states handled by this function include:
  * - BOOT: Initializes the system as main or sub module.
- * - GET_ADDR: Retrieves the address of the node.
- * - SET_ADDR: Sets the address of the next node and prepares for information requests.
- * - REQ_INFO: Requests information from the sub modules.
- * - RECV_INFO: Receives and processes information from sub modules.
+ * - GET_ADDR: Waits for the address token, see ModuleDiscovery.
+ * - SET_ADDR: Passes the address token to the next node, on the master until the chain is complete.
+ * - REQ_INFO: Waits for the sub modules to answer the info request.
+ * - RECV_INFO: Processes information from sub modules.
  * - INIT: Initializes the BMS hardware.
  * - SELFTEST: Performs self-tests and checks results.
  * - RUN: Operates the BMS and monitors current.
@@ -69,8 +78,14 @@ BmsFsm::BmsFsm(CanMap* cm, CanSdo* cs)
  */
 BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
 {
-   uint32_t data[2] = { 0 };
-   uint32_t sdoReply;
+   uint32_t canId, data[2];
+
+   //Enumeration keeps running in the background, e.g. the last module repeats the token for a while
+   if (discovery.Run(canId, data))
+      canMap->GetHardware()->Send(canId, data);
+
+   if (isMain && (currentState == RUN || currentState == IDLE))
+      AdmitRestartedModule();
 
    switch (currentState)
    {
@@ -78,72 +93,68 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
       if (IsFirst())
       {
          cycles = 0;
-         recvNodeId = Param::GetInt(Param::sdobase);
+         ourNodeId = Param::GetInt(Param::sdobase);
          pdobase = Param::GetInt(Param::pdobase);
-         canSdo->SetNodeId(recvNodeId);
+         canSdo->SetNodeId(ourNodeId);
          canMap->Clear();
+         PdoScheduler::Clear();
          DigIo::nextena_out.Set();
          isMain = true;
          MapCanMainmodule();
+         modules[0].numChan = Param::GetInt(Param::numchan);
          Param::SetInt(Param::totalcells, Param::GetInt(Param::numchan));
+         PackAggregator::Reset(1, TimeBase::GetMillis());
+         discovery.StartAsMaster(ourNodeId, pdobase, Param::GetInt(Param::numchan));
          return SET_ADDR;
       }
       else
       {
-         recvNodeId = 0;
+         //The backup domain survives a watchdog or brown out reset, so we may know our old place in the chain
+         uint8_t lastIndex = (BKP_DR3 & 0xFF00) == INDEX_HINT_MAGIC ? BKP_DR3 & 0xFF : DISC_NO_INDEX;
+         discovery.StartAsSub(Param::GetInt(Param::numchan), lastIndex);
          return GET_ADDR;
       }
       break;
    case GET_ADDR:
-      if (recvNodeId > 0)
+      if (discovery.HasAddress())
       {
-         ourNodeId = recvNodeId;
-         ourIndex = recvIndex;
-         pdobase = recvPdoBase;
+         ourNodeId = discovery.GetNodeId();
+         ourIndex = discovery.GetIndex();
+         pdobase = discovery.GetPdoBase();
          canSdo->SetNodeId(ourNodeId);
+         BKP_DR3 = INDEX_HINT_MAGIC | ourIndex;
          DigIo::nextena_out.Set();
          canMap->Clear();
+         PdoScheduler::Clear();
          MapCanSubmodule();
          Param::SetInt(Param::modaddr, ourNodeId);
          return SET_ADDR;
       }
       break;
    case SET_ADDR:
-      cycles++;
+      if (!isMain) return INIT; //Sub modules don't wait for the rest of the chain
 
-      if (cycles == BOOT_DELAY_CYCLES)
-      {
-         data[1] = recvNodeId + 1;
-         data[1] |= (ourIndex + 1) << 8;
-         data[1] |= pdobase << 16;
-         canMap->GetHardware()->Send(0x7dd, data);
-         cycles = 0;
-         return isMain ? REQ_INFO : INIT;
-      }
+      if (discovery.GetState() == ModuleDiscovery::COLLECT_INFO)
+         return REQ_INFO;
+      else if (discovery.GetState() == ModuleDiscovery::DONE)
+         return RECV_INFO;
       break;
    case REQ_INFO:
-      cycles++;
-
-      if (cycles == 10)
-      {
-         canSdo->SDORead(infoIndex + Param::GetInt(Param::sdobase), SDO_INDEX_PARAMS, (uint8_t)Param::numchan);
-
+      if (discovery.GetState() == ModuleDiscovery::DONE)
          return RECV_INFO;
-      }
       break;
    case RECV_INFO:
-      if (canSdo->SDOReadReply(sdoReply))
+      numModules = discovery.GetNumModules();
+
+      for (int i = 1; i < numModules; i++)
       {
-         numChan[infoIndex] = FP_TOINT(sdoReply); //numbers are transmitted in 5 bit fixed point
-         Param::SetInt(Param::totalcells, Param::GetInt(Param::totalcells) + numChan[infoIndex]);
-         numModules++;
-         Param::SetInt(Param::modnum, numModules);
-         infoIndex++;
-         cycles = 0;
-         return infoIndex < MAX_SUB_MODULES ? REQ_INFO : INIT;
+         modules[i].numChan = discovery.GetCellsOfModule(i);
+         Param::SetInt(Param::totalcells, Param::GetInt(Param::totalcells) + modules[i].numChan);
       }
+      Param::SetInt(Param::modnum, numModules);
+      PackAggregator::Reset(numModules, TimeBase::GetMillis());
+      Liveness::Reset(numModules, PDO_HEARTBEAT_MS, TimeBase::GetMillis());
       return INIT;
-      break;
    case INIT:
       FlyingAdcBms::Init();
       return SELFTEST;
@@ -220,27 +231,118 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
    return currentState;
 }
 
-Param::PARAM_NUM BmsFsm::GetDataItem(Param::PARAM_NUM baseItem, int modNum)
+/** \brief Gives a module that restarted in the running chain its place back
+ *
+ * We trust the index the module remembers only if that module went missing.
+ * Otherwise it takes the place of the first module that went missing. If no
+ * module goes missing in time it is a new module at the end of the chain.
+ */
+void BmsFsm::AdmitRestartedModule()
 {
-   const int numberOfParametersPerModule = 5;
-   if (modNum < 0) modNum = ourIndex;
+   uint8_t cells, lastIndex;
+   uint32_t lost = Liveness::GetLostMask();
+
+   if (!discovery.GetHello(cells, lastIndex))
+   {
+      helloCycles = 0;
+      return;
+   }
+
+   helloCycles++;
+
+   bool appendDue = helloCycles > (uint32_t)(Param::GetInt(Param::lostperiods) * (PDO_HEARTBEAT_MS / 100) + 10);
+   uint8_t mod = ModuleDiscovery::ChooseRestartIndex(lastIndex, lost, numModules, appendDue);
+
+   if (mod == 0) return; //Keep waiting, the module repeats its hello
+
+   uint32_t now = TimeBase::GetMillis();
+   int totalCells = 0;
+
+   helloCycles = 0;
+   discovery.Admit(mod);
+   modules[mod].numChan = cells;
+
+   if (mod >= numModules)
+   {
+      numModules = mod + 1;
+      Param::SetInt(Param::modnum, numModules);
+   }
+
+   for (int i = 0; i < numModules; i++)
+      totalCells += modules[i].numChan;
 
-   return (Param::PARAM_NUM)((int)baseItem + modNum * numberOfParametersPerModule);
+   Param::SetInt(Param::totalcells, totalCells);
+   Param::SetInt(Param::modrejoin, Param::GetInt(Param::modrejoin) + 1);
+   PackAggregator::Readmit(mod, now);
+   Liveness::Readmit(mod, now);
+}
+
+/** \brief Copies our own measurements into the module table */
+void BmsFsm::UpdateLocalModule()
+{
+   ModuleData& mod = modules[ourIndex];
+
+   mod.umin = Param::GetInt(Param::umin0);
+   mod.umax = Param::GetInt(Param::umax0);
+   mod.uavg = Param::GetInt(Param::uavg0);
+   mod.tempmin = Param::GetInt(Param::tempmin0);
+   mod.tempmax = Param::GetInt(Param::tempmax0);
+   mod.numChan = Param::GetInt(Param::numchan);
+
+   if (isMain)
+      PackAggregator::Update(ourIndex, mod, TimeBase::GetMillis());
+}
+
+/** \brief Sends the SYNC frame that starts the next cell sweep on all modules */
+void BmsFsm::SendSync()
+{
+   uint32_t data[2] = { syncCounter++, 0 };
+
+   canMap->GetHardware()->Send(CAN_ID_SYNC, data, 1);
 }
 
 void BmsFsm::HandleClear()
 {
-   canMap->GetHardware()->RegisterUserMessage(0x7dd);
+   canMap->GetHardware()->RegisterUserMessage(DISC_ID_TOKEN);
+   canMap->GetHardware()->RegisterUserMessage(DISC_ID_INFO_REQ);
+   canMap->GetHardware()->RegisterUserMessage(DISC_ID_HELLO);
+   canMap->GetHardware()->RegisterUserMessage(CAN_ID_SYNC);
+
+   for (uint32_t id = DISC_ID_INFO_RESP; id < (DISC_ID_INFO_RESP + MAX_MODULES); id += 16)
+      canMap->GetHardware()->RegisterUserMessage(id, 0x7F0);
+
+   if (isMain)
+      RegisterModuleMessages();
+   else if (discovery.HasAddress())
+      canMap->GetHardware()->RegisterUserMessage(pdobase + CURRENTFRAME_OFFSET);
 }
 
 void BmsFsm::HandleRx(uint32_t canId, uint32_t data[2], uint8_t)
 {
    switch (canId)
    {
-   case 0x7dd:
-      recvNodeId = data[1] & 0xFF;
-      recvIndex = (data[1] >> 8) & 0xFF;
-      recvPdoBase = data[1] >> 16;
+   case DISC_ID_TOKEN:
+   case DISC_ID_INFO_REQ:
+   case DISC_ID_HELLO:
+      discovery.HandleFrame(canId, data);
+      break;
+   case CAN_ID_SYNC:
+      BmsIO::HandleSync();
+      break;
+   default:
+      //Sub module PDOs, see MapCanSubmodule(). Ids below pdobase wrap around and are discarded
+      uint32_t mod = canId - pdobase - 1;
+      uint32_t cellMod = canId - pdobase - CELLSTREAM_OFFSET;
+
+      if (canId >= DISC_ID_INFO_RESP && canId < (DISC_ID_INFO_RESP + MAX_MODULES))
+         discovery.HandleFrame(canId, data);
+      else if (!isMain && canId == (uint32_t)(pdobase + CURRENTFRAME_OFFSET))
+         BmsIO::HandleCurrentFrame(data);
+      else if (isMain && mod > 0 && mod < MAX_MODULES)
+         ReceiveModuleData(mod, data);
+      else if (isMain && cellMod > 0 && cellMod < MAX_MODULES)
+         CellStream::Receive(cellMod, data);
+      break;
    }
 }
 
@@ -261,14 +363,17 @@ bool BmsFsm::IsEnabled()
 void BmsFsm::MapCanSubmodule()
 {
    int id = pdobase + ourIndex + 1; //main module has two PDO messages
-   canMap->AddSend(Param::umin0, id, 0, 14, 1);
-   canMap->AddSend(Param::umax0, id, 16, 14, 1);
-   canMap->AddSend(Param::counter, id, 30, 2, 1);
-   canMap->AddSend(Param::uavg0, id, 32, 14, 1);
-   canMap->AddSend(Param::tempmin0, id, 48, 8, 1);
-   canMap->AddSend(Param::tempmax0, id, 56, 8, 1);
-
-   canMap->AddRecv(Param::idcavg, pdobase, 32, 16, 0.1);
+   int msg = PdoScheduler::AddMessage(id, PdoScheduler::PERIOD_100MS, PDO_HEARTBEAT_MS, 30);
+   PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::umax0, 16, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::uavg0, 32, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::tempmin0, 48, 8, 1, 0);
+   PdoScheduler::AddField(msg, Param::tempmax0, 56, 8, 1, 0);
+   MapDiagnostics();
+
+   //Modules without their own sensor, also works with the current frame turned off
+   if (Param::GetInt(Param::idcmode) == IDC_OFF)
+      canMap->AddRecv(Param::idcavg, pdobase, 32, 16, 0.1);
    canMap->AddRecv(Param::umin, pdobase + 1, 0, 14, 1);
    canMap->AddRecv(Param::umax, pdobase + 1, 16, 14, 1);
    canMap->AddRecv(Param::uavg, pdobase + 1, 32, 14, 1);
@@ -276,30 +381,64 @@ void BmsFsm::MapCanSubmodule()
 
 void BmsFsm::MapCanMainmodule()
 {
-   for (int i = 1; i < GetMaxSubmodules(); i++)
-   {
-      int id = pdobase + i + 1;
-      canMap->AddRecv(GetDataItem(Param::umin0, i), id, 0, 14, 1);
-      canMap->AddRecv(GetDataItem(Param::umax0, i), id, 16, 14, 1);
-      canMap->AddRecv(GetDataItem(Param::uavg0, i), id, 32, 14, 1);
-      canMap->AddRecv(GetDataItem(Param::tempmin0, i), id, 48, 8, 1);
-      canMap->AddRecv(GetDataItem(Param::tempmax0, i), id, 56, 8, 1);
-   }
+   //Sub module data goes to the module table instead of parameters
+   RegisterModuleMessages();
 
    int id = Param::GetInt(Param::pdobase);
 
    //we don't expose our local accumulated values but the "global" ones
-   canMap->AddSend(Param::umin, id + 1, 0, 14, 1);
-   canMap->AddSend(Param::umax, id + 1, 16, 14, 1);
-   canMap->AddSend(Param::counter, id + 1, 30, 2, 1);
-   canMap->AddSend(Param::uavg, id + 1, 32, 14, 1);
-   canMap->AddSend(Param::tempmin, id + 1, 48, 8, 1);
-   canMap->AddSend(Param::tempmax, id + 1, 56, 8, 1);
-
-   canMap->AddSend(Param::chargelim, id, 0, 11, 1);
-   canMap->AddSend(Param::dischargelim, id, 11, 11, 1);
-   canMap->AddSend(Param::soc, id, 22, 10, 10);
-   canMap->AddSend(Param::idcavg, id, 32, 16, 10);
-   canMap->AddSend(Param::utotal, id, 48, 10, 0.001f);
-   canMap->AddSend(Param::counter, id, 62, 2, 1);
+   int msg = PdoScheduler::AddMessage(id + 1, PdoScheduler::PERIOD_100MS, PDO_HEARTBEAT_MS, 30);
+   PdoScheduler::AddField(msg, Param::umin, 0, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::umax, 16, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::uavg, 32, 14, 1, 2);
+   PdoScheduler::AddField(msg, Param::tempmin, 48, 8, 1, 0);
+   PdoScheduler::AddField(msg, Param::tempmax, 56, 8, 1, 0);
+
+   //Limits are checked every 10 ms so a change reaches the charger or inverter right away
+   msg = PdoScheduler::AddMessage(id, PdoScheduler::PERIOD_10MS, 100, 62);
+   PdoScheduler::AddField(msg, Param::chargelim, 0, 11, 1, 0.5f);
+   PdoScheduler::AddField(msg, Param::dischargelim, 11, 11, 1, 0.5f);
+   PdoScheduler::AddField(msg, Param::soc, 22, 10, 10, 0.05f);
+   PdoScheduler::AddField(msg, Param::idcavg, 32, 16, 10, 0.05f);
+   PdoScheduler::AddField(msg, Param::utotal, 48, 10, 0.001f, 500);
+   MapDiagnostics();
+}
+
+/** \brief Diagnostic values of each module, only for loggers */
+void BmsFsm::MapDiagnostics()
+{
+   int msg = PdoScheduler::AddMessage(pdobase + PDO_DIAG_OFFSET + ourIndex, PdoScheduler::PERIOD_1S, 1000, 62);
+   PdoScheduler::AddField(msg, Param::udelta, 0, 14, 1, 0);
+   PdoScheduler::AddField(msg, Param::syncskew, 16, 16, 1, 0);
+   PdoScheduler::AddField(msg, Param::cpuload, 32, 8, 1, 0);
+   PdoScheduler::AddField(msg, Param::lasterr, 40, 8, 1, 0);
+}
+
+/** \brief Registers the sub module PDOs and cell streams as user messages
+ * To save filter banks we register aligned blocks of 32 ids and sort out the rest in HandleRx()
+ */
+void BmsFsm::RegisterModuleMessages()
+{
+   uint32_t first = pdobase + 2;
+   uint32_t last = pdobase + CELLSTREAM_OFFSET + MAX_MODULES - 1;
+
+   for (uint32_t block = first & ~0x1Fu; block <= last; block += 32)
+      canMap->GetHardware()->RegisterUserMessage(block, 0x7E0);
+}
+
+void BmsFsm::ReceiveModuleData(uint8_t mod, uint32_t data[2])
+{
+   ModuleData& module = modules[mod];
+
+   module.umin = data[0] & 0x3FFF;
+   module.umax = (data[0] >> 16) & 0x3FFF;
+   module.uavg = data[1] & 0x3FFF;
+   module.tempmin = (int8_t)(data[1] >> 16);
+   module.tempmax = (int8_t)(data[1] >> 24);
+   //The scheduler tasks preempt the CAN interrupt and read or drop modules,
+   //so they must never see a module removed but not yet added back
+   cm_disable_interrupts();
+   PackAggregator::Update(mod, module, TimeBase::GetMillis());
+   cm_enable_interrupts();
+   Liveness::Receive(mod, (data[0] >> 30) & 0x3, TimeBase::GetMillis());
 }
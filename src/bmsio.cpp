@@ -16,15 +16,74 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <libopencm3/cm3/cortex.h>
 #include "bmsio.h"
 #include "params.h"
 #include "anain.h"
 #include "temp_meas.h"
 #include "my_math.h"
 #include "flyingadcbms.h"
+#include "selfdischarge.h"
+#include "timebase.h"
+#include "packaggregator.h"
+#include "currentframe.h"
+#include "trace.h"
+#include "capture.h"
+#include "energycounter.h"
+
+#define SYNC_TIMEOUT 40 //Fall back to free running sweeps when no SYNC arrived for 1 s
 
 BmsFsm* BmsIO::bmsFsm;
+BmsIO::CellConfig BmsIO::cellConfig;
+BmsIO::CurrentConfig BmsIO::currentConfig;
+BmsIO::TempConfig BmsIO::tempConfig;
 int BmsIO::muxRequest = -1;
+bool BmsIO::timingViolated = false;
+bool BmsIO::balancing = false;
+volatile bool BmsIO::syncReceived = false;
+volatile bool BmsIO::syncActive = false;
+volatile uint32_t BmsIO::syncTime;
+uint32_t BmsIO::syncTicks = 0;
+
+/** \brief Converts the measurement and balancing parameters for the hot paths
+ * Call on start up and whenever one of the parameters changes
+ */
+void BmsIO::UpdateConfig()
+{
+   CellConfig cell;
+   CurrentConfig cur;
+   TempConfig temp;
+   float gain = Param::GetFloat(Param::gain) / 1000.0f;
+   float idcgain = Param::GetFloat(Param::idcgain);
+
+   for (int i = 0; i < MAX_CELL_CHANNELS; i++)
+      cell.gain[i] = gain;
+
+   cell.gain[0] *= 1 + Param::GetFloat(Param::correction0) / 1000000.0f;
+   cell.gain[1] *= 1 + Param::GetFloat(Param::correction1) / 1000000.0f;
+   cell.gain[15] *= 1 + Param::GetFloat(Param::correction15) / 1000000.0f;
+   cell.numChan = Param::GetInt(Param::numchan);
+   cell.balMode = Param::GetInt(Param::balmode);
+   cell.ubalance = Param::GetFloat(Param::ubalance);
+   cell.balanceMax = Param::GetFloat(Param::ucell100soc);
+   cell.balanceCharge = Param::GetFloat(Param::ibalance) * 0.025f / 1000.0f;
+
+   cur.mode = Param::GetInt(Param::idcmode);
+   cur.gain = idcgain != 0 ? 1 / idcgain : 0;
+   cur.offset = Param::GetInt(Param::idcofs);
+   cur.idleThresh = Param::GetFloat(Param::idlethresh);
+
+   temp.sensor = Param::GetInt(Param::tempsns);
+   temp.nomRes = Param::GetInt(Param::tempres);
+   temp.beta = Param::GetInt(Param::tempbeta);
+
+   //The scheduler tasks must never see a half updated configuration
+   cm_disable_interrupts();
+   cellConfig = cell;
+   currentConfig = cur;
+   tempConfig = temp;
+   cm_enable_interrupts();
+}
 
 /** \brief Mux control function. Must be called in 2 ms interval */
 void BmsIO::SwitchMux()
@@ -61,13 +120,27 @@ void BmsIO::ReadCellVoltages()
    const int totalBalanceCycles = 30;
    static uint8_t chan = 0, balanceCycles = 0;
    static float sum = 0, min = 8000, max = 0;
-   int balMode = Param::GetInt(Param::balmode);
-   bool balance = Param::GetInt(Param::opmode) == BmsFsm::IDLE && Param::GetFloat(Param::uavg) > Param::GetFloat(Param::ubalance) && BAL_OFF != balMode;
+   static bool waitingForSync = false;
+   int balMode = cellConfig.balMode;
+   bool balance = Param::GetInt(Param::opmode) == BmsFsm::IDLE && Param::GetFloat(Param::uavg) > cellConfig.ubalance && BAL_OFF != balMode;
    FlyingAdcBms::BalanceStatus bstt;
 
+   balancing = balance;
+   syncTicks++;
+
+   //The sweep is complete, hold off the next one until the SYNC frame. Balancing sweeps are not synchronized
+   if (waitingForSync)
+   {
+      if (!balance && !SyncDue()) return;
+
+      waitingForSync = false;
+      muxRequest = 0; //Sample the first channel right now
+      return;
+   }
+
    if (balance)
    {
-      float balanceMax = Param::GetFloat(Param::ucell100soc);
+      float balanceMax = cellConfig.balanceMax;
       if (balanceCycles == 0)
       {
          balanceCycles = totalBalanceCycles; //this leads to switching to next channel below
@@ -112,7 +185,15 @@ void BmsIO::ReadCellVoltages()
             bstt = FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
             balanceCycles = 0;
          }
-         Param::SetInt((Param::PARAM_NUM)(Param::u0cmd + chan), bstt);
+         SetBalanceStatus(chan, bstt);
+
+         //Each call balances for 25 ms, self discharge analysis needs to know the moved charge
+         float balanceCharge = cellConfig.balanceCharge;
+
+         if (bstt == FlyingAdcBms::STT_DISCHARGE)
+            SelfDischarge::AddBalancingCharge(chan, -balanceCharge);
+         else if (bstt != FlyingAdcBms::STT_OFF)
+            SelfDischarge::AddBalancingCharge(chan, balanceCharge);
       }
       else
       {
@@ -123,25 +204,26 @@ void BmsIO::ReadCellVoltages()
    {
       balanceCycles = totalBalanceCycles;
       bstt = FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
-      Param::SetInt((Param::PARAM_NUM)(Param::u0cmd + chan), bstt);
+      SetBalanceStatus(chan, bstt);
    }
 
    //Read cell voltage when balancing is turned off
    if (balanceCycles == totalBalanceCycles)
    {
-      float gain = Param::GetFloat(Param::gain);
-      int numChan = Param::GetInt(Param::numchan);
+      int numChan = cellConfig.numChan;
       bool even = (chan & 1) == 0;
 
-      if (chan == 0)
-         gain *= 1 + Param::GetFloat(Param::correction0) / 1000000.0f;
-      else if (chan == 1)
-         gain *= 1 + Param::GetFloat(Param::correction1) / 1000000.0f;
-      else if (chan == 15)
-         gain *= 1 + Param::GetFloat(Param::correction15) / 1000000.0f;
+      if (timingViolated)
+      {
+         //Dead times of the mux or the ADC conversion time were not met, measure this channel again
+         timingViolated = false;
+         muxRequest = chan;
+         Param::SetInt(Param::tdiscard, Param::GetInt(Param::tdiscard) + 1);
+         return;
+      }
 
       //Read ADC result before mux change
-      float udc = FlyingAdcBms::GetResult() * (gain / 1000.0f);
+      float udc = FlyingAdcBms::GetResult() * cellConfig.gain[chan];
 
       Param::SetFloat((Param::PARAM_NUM)(Param::u0 + chan), udc);
 
@@ -170,17 +252,86 @@ void BmsIO::ReadCellVoltages()
          min = 8000;
          max = 0;
          sum = 0;
+         waitingForSync = !balance && UseSync();
       }
+
       //This instructs the SwitchMux task to change channel, with dead time
-      muxRequest = chan;
+      if (!waitingForSync)
+         muxRequest = chan;
    }
 }
 
+/** \brief Publishes the balancer state of a channel and traces changes */
+void BmsIO::SetBalanceStatus(int chan, FlyingAdcBms::BalanceStatus bstt)
+{
+   Param::PARAM_NUM param = (Param::PARAM_NUM)(Param::u0cmd + chan);
+
+   if (Param::GetInt(param) != bstt)
+      Trace::Add(Trace::TR_BALANCE, chan, bstt);
+
+   Param::SetInt(param, bstt);
+}
+
+/** \brief Records the arrival of a SYNC frame, called from CAN receive interrupt */
+void BmsIO::HandleSync()
+{
+   syncTime = TimeBase::GetCycles();
+   syncReceived = true;
+   syncActive = true;
+}
+
+bool BmsIO::UseSync()
+{
+   if (bmsFsm->IsFirst())
+      return Param::GetBool(Param::cellsync);
+   return syncActive;
+}
+
+/** \brief Decides whether the next sweep may start
+ *
+ * The master sends SYNC once the module with the most cells had time to
+ * complete its sweep. Sub modules start their sweep on the first call after
+ * receiving SYNC and measure how long that took.
+ *
+ * \return true to start the next sweep
+ */
+bool BmsIO::SyncDue()
+{
+   if (bmsFsm->IsFirst())
+   {
+      uint32_t maxCells = 0;
+
+      for (int i = 0; i < bmsFsm->GetNumberOfModules(); i++)
+         maxCells = MAX(maxCells, bmsFsm->GetCellsOfModule(i));
+
+      //One call for requesting the first channel plus one per cell
+      if (syncTicks <= maxCells) return false;
+
+      bmsFsm->SendSync();
+      syncTicks = 0;
+      Param::SetInt(Param::syncskew, 0);
+      return true;
+   }
+   else if (syncReceived)
+   {
+      syncReceived = false;
+      syncTicks = 0;
+      Param::SetInt(Param::syncskew, TimeBase::CyclesToMicros(TimeBase::GetCycles() - syncTime));
+      return true;
+   }
+   else if (syncTicks > SYNC_TIMEOUT)
+   {
+      syncActive = false;
+      return true;
+   }
+   return false;
+}
+
 void BmsIO::ReadTemperatures()
 {
-   int sensor = Param::GetInt(Param::tempsns);
-   int nomRes = Param::GetInt(Param::tempres);
-   int beta = Param::GetInt(Param::tempbeta);
+   int sensor = tempConfig.sensor;
+   int nomRes = tempConfig.nomRes;
+   int beta = tempConfig.beta;
    float temp1 = NO_TEMP, temp2 = NO_TEMP, tempmin = NO_TEMP, tempmax = NO_TEMP;
 
    if (sensor & 1)
@@ -199,76 +350,105 @@ void BmsIO::ReadTemperatures()
    Param::SetFloat(Param::tempmax0, tempmax);
 }
 
-void BmsIO::MeasureCurrent()
+/** \brief Samples the analog current sensor
+ * \param dt time since the last call in s
+ */
+void BmsIO::MeasureCurrent(float dt)
 {
-   int idcmode = Param::GetInt(Param::idcmode);
+   int idcmode = currentConfig.mode;
 
    if (idcmode == IDC_DIFFERENTIAL || idcmode == IDC_SINGLE)
    {
-      float current = 0;
-      static int samples = 0;
-      static u32fp amsIn = 0, amsOut = 0;
-      static float idcavg = 0;
       int curpos = AnaIn::curpos.Get();
       int curneg = AnaIn::curneg.Get();
-      float idcgain = Param::GetFloat(Param::idcgain);
-      int idcofs = Param::GetInt(Param::idcofs);
       int rawCurrent = idcmode == IDC_SINGLE ? curpos : curpos - curneg;
+      float current = (rawCurrent - currentConfig.offset) * currentConfig.gain;
 
-      current = (rawCurrent - idcofs) / idcgain;
+      if (Capture::IsActive())
+         Capture::AddSample(curpos, curneg, current);
 
-      if (current < -Param::GetFloat(Param::idlethresh))
-      {
-         amsOut += -FP_FROMFLT(current);
-      }
-      else if (current > Param::GetFloat(Param::idlethresh))
-      {
-         amsIn += FP_FROMFLT(current);
-      }
+      IntegrateCurrent(current, dt);
+      Param::SetFloat(Param::idc, current);
+   }
+}
 
-      idcavg += current;
-      samples++;
+/** \brief Processes the current frame of the module that owns the shunt
+ * Only used when we don't measure current ourselves
+ */
+void BmsIO::HandleCurrentFrame(const uint32_t data[2])
+{
+   float current, dt;
 
-      if (samples == 200)
-      {
-         s32fp chargein = Param::Get(Param::chargein);
-         s32fp chargeout = Param::Get(Param::chargeout);
+   if (currentConfig.mode != IDC_OFF) return;
 
-         chargein += amsIn / 200;
-         chargeout += amsOut / 200;
-         idcavg /= 200;
+   if (CurrentFrame::Receive(data, current, dt))
+      IntegrateCurrent(current, dt);
 
-         float voltage = Param::GetFloat(Param::utotal) / 1000;
-         float power = voltage * idcavg;
+   Param::SetFloat(Param::idc, current);
+}
 
-         Param::SetFloat(Param::idcavg, idcavg);
-         Param::SetFloat(Param::power, power);
+/** \brief Processes a current sample of a CAN current sensor
+ *
+ * \param current current in A
+ * \param dt time since the previous sample in s, measured by the sensor
+ *
+ */
+void BmsIO::HandleIsaCurrent(float current, float dt)
+{
+   if (currentConfig.mode != IDC_ISACAN) return;
 
-         amsIn = 0;
-         amsOut = 0;
-         samples = 0;
-         idcavg = 0;
+   IntegrateCurrent(current, dt);
+   Param::SetFloat(Param::idc, current);
+}
 
-         //BmsCalculation::SetCharge(chargein, chargeout);
-         Param::SetFixed(Param::chargein, chargein);
-         Param::SetFixed(Param::chargeout, chargeout);
-      }
-      Param::SetFloat(Param::idc, current);
+/** \brief Counts charge and averages the current over one second
+ *
+ * \param current current in A
+ * \param dt time since the last call in s
+ *
+ */
+void BmsIO::IntegrateCurrent(float current, float dt)
+{
+   static float chargeIn = 0, chargeOut = 0, charge = 0, time = 0;
+
+   if (current < -currentConfig.idleThresh)
+   {
+      chargeOut += -current * dt;
+   }
+   else if (current > currentConfig.idleThresh)
+   {
+      chargeIn += current * dt;
+   }
+
+   charge += current * dt;
+   time += dt;
+
+   if (time >= 1)
+   {
+      float idcavg = charge / time;
+      float voltage = Param::GetFloat(Param::utotal) / 1000;
+      float power = voltage * idcavg;
+
+      //Without our own sensor idcavg comes from the master's limits PDO
+      if (currentConfig.mode != IDC_OFF)
+         Param::SetFloat(Param::idcavg, idcavg);
+      Param::SetFloat(Param::power, power);
+      Param::SetFloat(Param::chargein, Param::GetFloat(Param::chargein) + chargeIn);
+      Param::SetFloat(Param::chargeout, Param::GetFloat(Param::chargeout) + chargeOut);
+      EnergyCounter::Add(chargeIn, chargeOut, voltage);
+      Param::SetFloat(Param::energyin, EnergyCounter::GetIn());
+      Param::SetFloat(Param::energyout, EnergyCounter::GetOut());
+
+      chargeIn = 0;
+      chargeOut = 0;
+      charge = 0;
+      time = 0;
    }
 }
 
 void BmsIO::TestReadCellVoltage(int chan, FlyingAdcBms::BalanceCommand cmd)
 {
-   float gain = Param::GetFloat(Param::gain);
-
-   if (chan == 0)
-      gain *= 1 + Param::GetFloat(Param::correction0) / 1000000.0f;
-   else if (chan == 1)
-      gain *= 1 + Param::GetFloat(Param::correction1) / 1000000.0f;
-   else if (chan == 15)
-      gain *= 1 + Param::GetFloat(Param::correction15) / 1000000.0f;
-
-   float udc = FlyingAdcBms::GetResult() * (gain / 1000.0f);;
+   float udc = FlyingAdcBms::GetResult() * cellConfig.gain[chan];
    FlyingAdcBms::SelectChannel(chan);
    FlyingAdcBms::SetBalancing(cmd);
    FlyingAdcBms::StartAdc();
@@ -282,38 +462,19 @@ void BmsIO::Accumulate(float sum, float min, float max, float avg)
       Param::SetFloat(Param::uavg0, avg);
       Param::SetFloat(Param::umin0, min);
       Param::SetFloat(Param::umax0, max);
+      //This also updates the pack aggregation, the sub modules update it when their PDO arrives
+      bmsFsm->UpdateLocalModule();
 
-      float totalSum = sum, totalMin = min, totalMax = max;
-      //If we are the first module accumulate our values with those from the sub modules
-      for (int i = 1; i < bmsFsm->GetNumberOfModules(); i++)
-      {
-         //Here we undo the local average calculation on the module to calculate the substrings total voltage
-         totalSum += Param::GetFloat(bmsFsm->GetDataItem(Param::uavg0, i)) * bmsFsm->GetCellsOfModule(i);
-         totalMin = MIN(totalMin, Param::GetFloat(bmsFsm->GetDataItem(Param::umin0, i)));
-         totalMax = MAX(totalMax, Param::GetFloat(bmsFsm->GetDataItem(Param::umax0, i)));
-      }
-
-      float tempmin = NO_TEMP, tempmax = -40;
-
-      for (int i = 0; i < bmsFsm->GetNumberOfModules(); i++)
-      {
-         float tempmin0 = Param::GetFloat(bmsFsm->GetDataItem(Param::tempmin0, i));
-         float tempmax0 = Param::GetFloat(bmsFsm->GetDataItem(Param::tempmax0, i));
-
-         if (tempmin0 < NO_TEMP)
-         {
-            tempmin = MIN(tempmin, tempmin0);
-            tempmax = MAX(tempmax, tempmax0);
-         }
-      }
+      float totalMin = PackAggregator::GetMin();
+      float totalMax = PackAggregator::GetMax();
 
       Param::SetFloat(Param::umin, totalMin);
       Param::SetFloat(Param::umax, totalMax);
-      Param::SetFloat(Param::uavg, totalSum / Param::GetInt(Param::totalcells));
+      Param::SetFloat(Param::uavg, PackAggregator::GetAverage());
       Param::SetFloat(Param::udelta, totalMax - totalMin);
-      Param::SetFloat(Param::utotal, totalSum);
-      Param::SetFloat(Param::tempmin, tempmin);
-      Param::SetFloat(Param::tempmax, tempmax);
+      Param::SetInt(Param::utotal, PackAggregator::GetSum());
+      Param::SetInt(Param::tempmin, PackAggregator::GetTempMin());
+      Param::SetInt(Param::tempmax, PackAggregator::GetTempMax());
    }
    else //if we are a sub module write averages straight to data module
    {
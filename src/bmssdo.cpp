@@ -0,0 +1,213 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bmssdo.h"
+#include "my_fp.h"
+#include "selfdischarge.h"
+#include "cyclecounter.h"
+#include "cellstream.h"
+#include "liveness.h"
+#include "taskprofiler.h"
+#include "trace.h"
+#include "lifetimestats.h"
+#include "capture.h"
+
+BmsFsm* BmsSdo::bmsFsm;
+
+/** \brief Handles the BMS specific SDO indexes
+ *
+ * \param sdo SDO request, is turned into the reply
+ * \return true if the index was handled, false to pass it on to the standard commands
+ *
+ */
+bool BmsSdo::ProcessCommand(CanSdo::SdoFrame* sdo)
+{
+   switch (sdo->index)
+   {
+   case SDO_INDEX_SELFDISCHARGE:
+      ReplyRead(sdo, FP_FROMFLT(SelfDischarge::GetLeakageCurrent(sdo->subIndex)), sdo->subIndex < SD_MAX_CELLS);
+      return true;
+   case SDO_INDEX_CYCLES:
+      ReplyRead(sdo, CycleCounter::GetHalfCycles(sdo->subIndex / CC_DEPTH_BINS, sdo->subIndex % CC_DEPTH_BINS),
+                sdo->subIndex < CC_MEAN_BINS * CC_DEPTH_BINS);
+      return true;
+   case SDO_INDEX_CELLS:
+      ReplyRead(sdo, FP_FROMINT(CellStream::GetCell(sdo->subIndex)), true);
+      return true;
+   case SDO_INDEX_JITTER:
+      ReplyRead(sdo, TaskProfiler::GetJitterCount(sdo->subIndex / TASKPROF_JITTER_BINS, sdo->subIndex % TASKPROF_JITTER_BINS),
+                sdo->subIndex < TASKPROF_MAX_TASKS * TASKPROF_JITTER_BINS);
+      return true;
+   case SDO_INDEX_CELLTIME:
+      ReplyRead(sdo, LifetimeStats::GetVoltageTime(sdo->subIndex / LS_VOLTAGE_BINS, sdo->subIndex % LS_VOLTAGE_BINS),
+                sdo->subIndex < LS_CELLS * LS_VOLTAGE_BINS);
+      return true;
+   case SDO_INDEX_TEMPTIME:
+      ReplyRead(sdo, LifetimeStats::GetTemperatureTime(sdo->subIndex), sdo->subIndex < LS_TEMP_BINS);
+      return true;
+   case SDO_INDEX_EXTREMES:
+      ReplyRead(sdo, LifetimeStats::GetExtreme((LifetimeStats::Extreme)sdo->subIndex), sdo->subIndex < LifetimeStats::EX_LAST);
+      return true;
+   case SDO_INDEX_CAPTURECTRL:
+      ProcessCaptureControl(sdo);
+      return true;
+   case SDO_INDEX_TRACECTRL:
+      ProcessTraceControl(sdo);
+      return true;
+   default:
+      if (sdo->index >= SDO_INDEX_CAPTURE && sdo->index < (SDO_INDEX_CAPTURE + CAPTURE_SIZE / 256))
+      {
+         uint32_t value = 0;
+         bool valid = Capture::GetSample((sdo->index - SDO_INDEX_CAPTURE) * 256 + sdo->subIndex, value);
+         ReplyRead(sdo, value, valid);
+         return true;
+      }
+      if (sdo->index >= SDO_INDEX_TRACE && sdo->index < (SDO_INDEX_TRACE + TRACE_WORDS))
+      {
+         uint32_t value = 0;
+         bool valid = Trace::GetWord(sdo->subIndex, sdo->index - SDO_INDEX_TRACE, value);
+         ReplyRead(sdo, value, valid);
+         return true;
+      }
+      if (sdo->index >= SDO_INDEX_MODULES && sdo->index < (SDO_INDEX_MODULES + MOD_LAST))
+      {
+         ReadModuleItem(sdo);
+         return true;
+      }
+      if (sdo->index >= SDO_INDEX_LIVENESS && sdo->index < (SDO_INDEX_LIVENESS + Liveness::STAT_LAST))
+      {
+         ReadLivenessItem(sdo);
+         return true;
+      }
+      if (sdo->index >= SDO_INDEX_PROFILER && sdo->index < (SDO_INDEX_PROFILER + TaskProfiler::STAT_LAST))
+      {
+         ProcessProfilerItem(sdo);
+         return true;
+      }
+      return false;
+   }
+}
+
+void BmsSdo::ReplyRead(CanSdo::SdoFrame* sdo, uint32_t value, bool valid)
+{
+   if (sdo->cmd == SDO_READ && valid)
+   {
+      sdo->cmd = SDO_READ_REPLY;
+      sdo->data = value;
+   }
+   else
+   {
+      sdo->cmd = SDO_ABORT;
+      sdo->data = SDO_ERR_INVIDX;
+   }
+}
+
+/** \brief Reads one item of the module table, values are in 5 bit fixed point like parameters */
+void BmsSdo::ReadModuleItem(CanSdo::SdoFrame* sdo)
+{
+   const ModuleData* mod = bmsFsm->GetModuleData(sdo->subIndex);
+   s32fp value = 0;
+
+   if (mod != 0)
+   {
+      switch (sdo->index - SDO_INDEX_MODULES)
+      {
+      case MOD_UMIN: value = FP_FROMINT(mod->umin); break;
+      case MOD_UMAX: value = FP_FROMINT(mod->umax); break;
+      case MOD_UAVG: value = FP_FROMINT(mod->uavg); break;
+      case MOD_TEMPMIN: value = FP_FROMINT(mod->tempmin); break;
+      case MOD_TEMPMAX: value = FP_FROMINT(mod->tempmax); break;
+      case MOD_NUMCHAN: value = FP_FROMINT(mod->numChan); break;
+      }
+   }
+
+   ReplyRead(sdo, value, sdo->subIndex < bmsFsm->GetNumberOfModules());
+}
+
+/** \brief Reads one frame statistic of a sub module */
+void BmsSdo::ReadLivenessItem(CanSdo::SdoFrame* sdo)
+{
+   Liveness::Stat stat = (Liveness::Stat)(sdo->index - SDO_INDEX_LIVENESS);
+
+   ReplyRead(sdo, FP_FROMINT(Liveness::GetStat(sdo->subIndex, stat)), sdo->subIndex < bmsFsm->GetNumberOfModules());
+}
+
+/** \brief Reads one execution time or deadline statistic of a task, writing any item resets all statistics */
+void BmsSdo::ProcessProfilerItem(CanSdo::SdoFrame* sdo)
+{
+   if (sdo->cmd == SDO_WRITE)
+   {
+      TaskProfiler::Reset();
+      sdo->cmd = SDO_WRITE_REPLY;
+      return;
+   }
+
+   TaskProfiler::Stat stat = (TaskProfiler::Stat)(sdo->index - SDO_INDEX_PROFILER);
+   ReplyRead(sdo, TaskProfiler::GetStat(sdo->subIndex, stat), sdo->subIndex < TASKPROF_MAX_TASKS);
+}
+
+/** \brief Freezes the trace for reading it out or reads its counters */
+void BmsSdo::ProcessTraceControl(CanSdo::SdoFrame* sdo)
+{
+   if (sdo->cmd == SDO_WRITE && sdo->subIndex == 0)
+   {
+      Trace::Freeze(sdo->data != 0);
+      sdo->cmd = SDO_WRITE_REPLY;
+      return;
+   }
+
+   ReplyRead(sdo, sdo->subIndex == 0 ? Trace::GetCount() : Trace::GetDropped(), sdo->subIndex < 2);
+}
+
+/** \brief Configures, arms and reads the status of the current capture */
+void BmsSdo::ProcessCaptureControl(CanSdo::SdoFrame* sdo)
+{
+   if (sdo->cmd == SDO_WRITE)
+   {
+      sdo->cmd = SDO_WRITE_REPLY;
+
+      switch (sdo->subIndex)
+      {
+      case CAP_ARM: Capture::Arm(sdo->data); break;
+      case CAP_LEVEL: Capture::SetLevel(sdo->data); break;
+      case CAP_SLOPE: Capture::SetSlope(sdo->data); break;
+      case CAP_PRETRIGGER: Capture::SetPreTrigger(sdo->data); break;
+      case CAP_FIRE: Capture::Trigger(Capture::TRIG_MANUAL); break;
+      default:
+         sdo->cmd = SDO_ABORT;
+         sdo->data = SDO_ERR_INVIDX;
+         break;
+      }
+      return;
+   }
+
+   uint32_t value = 0;
+
+   switch (sdo->subIndex)
+   {
+   case CAP_ARM: value = Capture::GetState(); break;
+   case CAP_LEVEL: value = Capture::GetLevel(); break;
+   case CAP_SLOPE: value = Capture::GetSlope(); break;
+   case CAP_PRETRIGGER: value = Capture::GetPreTrigger(); break;
+   case CAP_SOURCE: value = Capture::GetTriggerSource(); break;
+   case CAP_TRIGINDEX: value = Capture::GetTriggerIndex(); break;
+   case CAP_COUNT: value = Capture::GetCount(); break;
+   }
+
+   ReplyRead(sdo, value, sdo->subIndex < CAP_LAST && sdo->subIndex != CAP_FIRE);
+}
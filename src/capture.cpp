@@ -0,0 +1,151 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "capture.h"
+#include "my_math.h"
+
+uint32_t Capture::buffer[CAPTURE_SIZE];
+float Capture::level = 500;
+float Capture::slope = 100;
+float Capture::lastCurrent;
+uint32_t Capture::total;
+uint32_t Capture::triggerSample;
+int Capture::preTrigger = CAPTURE_SIZE / 4;
+int Capture::count;
+int Capture::head;
+int Capture::remaining;
+uint8_t Capture::triggers;
+uint8_t Capture::triggerSource;
+volatile Capture::State Capture::state = CAP_IDLE;
+volatile bool Capture::active = false;
+
+/** \brief Sets how many samples before the trigger are kept */
+void Capture::SetPreTrigger(int samples)
+{
+   preTrigger = MAX(0, MIN(samples, CAPTURE_SIZE - 1));
+}
+
+/** \brief Starts recording and waits for a trigger
+ * \param triggerMask combination of Trigger values, 0 disarms
+ */
+void Capture::Arm(uint8_t triggerMask)
+{
+   active = false;
+
+   if (triggerMask == 0)
+   {
+      Disarm();
+      return;
+   }
+
+   triggers = triggerMask;
+   triggerSource = 0;
+   total = 0;
+   count = 0;
+   head = 0;
+   state = CAP_ARMED;
+   active = true; //Set last, the sampling task may interrupt us
+}
+
+void Capture::Disarm()
+{
+   active = false;
+   if (state != CAP_DONE)
+      state = CAP_IDLE;
+}
+
+/** \brief Records one sample and checks the level and slope triggers
+ *
+ * \param curpos raw ADC value of the positive current input
+ * \param curneg raw ADC value of the negative current input
+ * \param current the sample converted to A
+ *
+ */
+void Capture::AddSample(int16_t curpos, int16_t curneg, float current)
+{
+   buffer[head] = (uint16_t)curpos | ((uint32_t)(uint16_t)curneg << 16);
+   head = (head + 1) & (CAPTURE_SIZE - 1);
+   count = MIN(count + 1, CAPTURE_SIZE);
+   total++;
+
+   if (state == CAP_ARMED)
+   {
+      uint8_t fired = 0;
+
+      if ((triggers & TRIG_LEVEL) && ABS(current) >= level)
+         fired |= TRIG_LEVEL;
+      if ((triggers & TRIG_SLOPE) && total > 1 && ABS(current - lastCurrent) >= slope)
+         fired |= TRIG_SLOPE;
+
+      lastCurrent = current;
+
+      if (fired)
+         Fire(fired, total - 1);
+   }
+   else if (state == CAP_TRIGGERED && --remaining <= 0)
+   {
+      state = CAP_DONE;
+      active = false;
+   }
+}
+
+/** \brief Fires an external trigger, the next sample is the trigger sample
+ * \param source TRIG_STATE or TRIG_MANUAL, ignored unless enabled when arming
+ */
+void Capture::Trigger(uint8_t source)
+{
+   if (state == CAP_ARMED && (triggers & source))
+      Fire(source, total);
+}
+
+/** \brief Returns the position of the trigger sample in the readout, -1 if not triggered */
+int Capture::GetTriggerIndex()
+{
+   if (state != CAP_TRIGGERED && state != CAP_DONE) return -1;
+   return triggerSample - (total - count);
+}
+
+/** \brief Reads one recorded sample
+ *
+ * \param idx sample index, 0 is the oldest one
+ * \param[out] value curpos | curneg << 16
+ * \return false while recording or if the index is out of range
+ *
+ */
+bool Capture::GetSample(int idx, uint32_t& value)
+{
+   if (active || idx < 0 || idx >= count) return false;
+
+   value = buffer[(head - count + idx) & (CAPTURE_SIZE - 1)];
+   return true;
+}
+
+void Capture::Fire(uint8_t source, uint32_t sample)
+{
+   triggerSource = source;
+   triggerSample = sample;
+   //Samples still to record after the trigger sample
+   remaining = CAPTURE_SIZE - preTrigger - (sample < total ? 1 : 0);
+   state = CAP_TRIGGERED;
+
+   if (remaining <= 0)
+   {
+      state = CAP_DONE;
+      active = false;
+   }
+}
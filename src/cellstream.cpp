@@ -0,0 +1,121 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cellstream.h"
+#include "my_math.h"
+
+#define CALLS_PER_SECOND 10
+#define CELL_MASK        0x3FFF
+
+uint16_t CellStream::cells[MAX_MODULES * CELLSTREAM_MAX_CELLS];
+float CellStream::framesPerCall = 1;
+float CellStream::credit = 0;
+uint8_t CellStream::nextMux = 0;
+
+/** \brief Sets the bandwidth budget of this module's cell stream
+ *
+ * \param framesPerSecond frames per second, 0 to turn off the stream
+ *
+ */
+void CellStream::SetFrameRate(float framesPerSecond)
+{
+   framesPerCall = framesPerSecond / CALLS_PER_SECOND;
+}
+
+/** \brief Sends as many cell frames as the bandwidth budget allows, call every 100 ms
+ *
+ * Each frame carries a mux byte and four 14 bit cell voltages in mV. The mux
+ * byte is the index of the first cell divided by four. Our own cells are also
+ * stored in the pack wide array.
+ *
+ * \param can CAN interface to send on
+ * \param canId id of our cell stream
+ * \param module our index in the module chain
+ * \param voltages cell voltages in mV
+ * \param numCells number of cells
+ *
+ */
+void CellStream::Run(CanHardware* can, uint32_t canId, uint8_t module, const float* voltages, int numCells)
+{
+   uint16_t frameCells[CELLSTREAM_PER_FRAME];
+   uint32_t data[2];
+   int numFrames = (MIN(numCells, CELLSTREAM_MAX_CELLS) + CELLSTREAM_PER_FRAME - 1) / CELLSTREAM_PER_FRAME;
+
+   if (module >= MAX_MODULES || numFrames == 0) return;
+
+   for (int i = 0; i < MIN(numCells, CELLSTREAM_MAX_CELLS); i++)
+      cells[module * CELLSTREAM_MAX_CELLS + i] = MAX(0, voltages[i]);
+
+   credit = MIN(credit + framesPerCall, numFrames); //Don't accumulate more than one sweep
+
+   while (credit >= 1)
+   {
+      if (nextMux >= numFrames) nextMux = 0;
+
+      for (int i = 0; i < CELLSTREAM_PER_FRAME; i++)
+      {
+         int cell = nextMux * CELLSTREAM_PER_FRAME + i;
+         frameCells[i] = cell < numCells ? cells[module * CELLSTREAM_MAX_CELLS + cell] : 0;
+      }
+
+      Encode(nextMux, frameCells, data);
+      can->Send(canId, data);
+      nextMux++;
+      credit -= 1;
+   }
+}
+
+/** \brief Stores a received cell frame in the pack wide cell array
+ *
+ * \param module index of the sending module
+ * \param data frame payload
+ *
+ */
+void CellStream::Receive(uint8_t module, const uint32_t data[2])
+{
+   uint64_t frame = data[0] | ((uint64_t)data[1] << 32);
+   uint8_t mux = frame & 0xFF;
+
+   if (module >= MAX_MODULES || mux >= (CELLSTREAM_MAX_CELLS / CELLSTREAM_PER_FRAME)) return;
+
+   for (int i = 0; i < CELLSTREAM_PER_FRAME; i++)
+      cells[module * CELLSTREAM_MAX_CELLS + mux * CELLSTREAM_PER_FRAME + i] = (frame >> (8 + 14 * i)) & CELL_MASK;
+}
+
+/** \brief Returns a cell from the pack wide array
+ *
+ * \param packCell module index * CELLSTREAM_MAX_CELLS + cell index
+ * \return cell voltage in mV, 0 if never received
+ *
+ */
+uint16_t CellStream::GetCell(int packCell)
+{
+   if (packCell < 0 || packCell >= (MAX_MODULES * CELLSTREAM_MAX_CELLS)) return 0;
+   return cells[packCell];
+}
+
+void CellStream::Encode(uint8_t mux, const uint16_t* frameCells, uint32_t data[2])
+{
+   uint64_t frame = mux;
+
+   for (int i = 0; i < CELLSTREAM_PER_FRAME; i++)
+      frame |= (uint64_t)(frameCells[i] & CELL_MASK) << (8 + 14 * i);
+
+   data[0] = frame;
+   data[1] = frame >> 32;
+}
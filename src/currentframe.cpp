@@ -0,0 +1,84 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "currentframe.h"
+#include "my_math.h"
+
+#define CALLS_PER_SECOND 200
+
+float CurrentFrame::framesPerCall = 0;
+float CurrentFrame::credit = 0;
+float CurrentFrame::sum = 0;
+int CurrentFrame::samples = 0;
+uint32_t CurrentFrame::lastTime = 0;
+bool CurrentFrame::lastValid = false;
+
+/** \brief Sets the frame rate
+ * \param framesPerSecond frames per second, at most 200, 0 to turn off
+ */
+void CurrentFrame::SetFrameRate(float framesPerSecond)
+{
+   framesPerCall = MAX(0, MIN(framesPerSecond, CALLS_PER_SECOND)) / CALLS_PER_SECOND;
+}
+
+/** \brief Adds a current sample and builds a frame when one is due, call every 5 ms
+ *
+ * \param current current in A
+ * \param timeMs time stamp of the sample
+ * \param[out] data frame payload, current in mA and time stamp in ms
+ * \return true if the frame must be sent
+ *
+ */
+bool CurrentFrame::Run(float current, uint32_t timeMs, uint32_t data[2])
+{
+   if (framesPerCall == 0) return false;
+
+   sum += current;
+   samples++;
+   credit = MIN(credit + framesPerCall, 1);
+
+   if (credit < 1) return false;
+
+   credit -= 1;
+   data[0] = (int32_t)(1000 * sum / samples);
+   data[1] = timeMs;
+   sum = 0;
+   samples = 0;
+   return true;
+}
+
+/** \brief Decodes a current frame
+ *
+ * \param data frame payload
+ * \param[out] current average current since the last frame in A
+ * \param[out] dt time since the last frame in s
+ * \return true if current and dt are valid, the first frame after a gap is not
+ *
+ */
+bool CurrentFrame::Receive(const uint32_t data[2], float& current, float& dt)
+{
+   uint32_t gap = data[1] - lastTime;
+   bool valid = lastValid && gap > 0 && gap <= CURRENTFRAME_MAX_GAP;
+
+   current = (int32_t)data[0] / 1000.0f;
+   dt = gap / 1000.0f;
+   lastTime = data[1];
+   lastValid = true;
+
+   return valid;
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cyclecounter.h"
+#include "my_math.h"
+
+#define SOC_HYSTERESIS 1.0f //Ignore SoC wiggles smaller than 1%
+
+CycleCounter::Data CycleCounter::data;
+float CycleCounter::stack[CC_STACK_SIZE];
+int CycleCounter::stackSize = 0;
+float CycleCounter::peak;
+int CycleCounter::direction = 0;
+float CycleCounter::lastChargeIn = -1;
+float CycleCounter::lastChargeOut = -1;
+
+/** \brief Feeds the SoC trajectory into the streaming rainflow counter
+ *
+ * A reversal is only confirmed once the SoC has moved away from the last
+ * extreme value by more than the hysteresis.
+ *
+ * \param soc current SoC in %
+ *
+ */
+void CycleCounter::AddSoc(float soc)
+{
+   if (stackSize == 0)
+   {
+      PushReversal(soc);
+      peak = soc;
+      direction = 0;
+   }
+   else if (direction == 0)
+   {
+      if (ABS(soc - stack[0]) >= SOC_HYSTERESIS)
+      {
+         direction = soc > stack[0] ? 1 : -1;
+         peak = soc;
+      }
+   }
+   else if ((soc - peak) * direction > 0)
+   {
+      peak = soc; //still moving in the same direction
+   }
+   else if (ABS(soc - peak) >= SOC_HYSTERESIS)
+   {
+      PushReversal(peak);
+      direction = -direction;
+      peak = soc;
+   }
+}
+
+/** \brief Adds charge throughput
+ *
+ * \param chargeIn charge into the battery since boot in As
+ * \param chargeOut charge out of the battery since boot in As
+ *
+ */
+void CycleCounter::AddCharge(float chargeIn, float chargeOut)
+{
+   if (lastChargeIn >= 0 && chargeIn >= lastChargeIn)
+      data.chargeIn += (chargeIn - lastChargeIn) / 3600;
+   if (lastChargeOut >= 0 && chargeOut >= lastChargeOut)
+      data.chargeOut += (chargeOut - lastChargeOut) / 3600;
+
+   lastChargeIn = chargeIn;
+   lastChargeOut = chargeOut;
+}
+
+/** \brief Returns the number of equivalent full cycles, i.e. throughput divided by twice the capacity */
+float CycleCounter::GetEquivalentFullCycles(float nominalCapacity)
+{
+   if (nominalCapacity <= 0) return 0;
+   return GetThroughput() / (2 * nominalCapacity);
+}
+
+/** \brief Returns the number of counted half cycles in a histogram bin
+ *
+ * \param meanBin mean SoC bin, 0=0-20%, 1=20-40% etc.
+ * \param depthBin depth of discharge bin, 0=0-10%, 1=10-20% etc.
+ * \return number of half cycles, a full cycle counts as 2
+ *
+ */
+uint32_t CycleCounter::GetHalfCycles(int meanBin, int depthBin)
+{
+   if (meanBin >= CC_MEAN_BINS || depthBin >= CC_DEPTH_BINS) return 0;
+   return data.halfCycles[meanBin * CC_DEPTH_BINS + depthBin];
+}
+
+void CycleCounter::Reset()
+{
+   for (int i = 0; i < CC_MEAN_BINS * CC_DEPTH_BINS; i++)
+      data.halfCycles[i] = 0;
+
+   data.chargeIn = 0;
+   data.chargeOut = 0;
+   stackSize = 0;
+}
+
+/** \brief Adds a reversal to the residue stack and extracts closed cycles
+ *
+ * This is the ASTM E1049 three point algorithm. Each reversal is pushed and
+ * popped at most once so the run time is amortized O(1).
+ */
+void CycleCounter::PushReversal(float soc)
+{
+   if (stackSize == CC_STACK_SIZE)
+   {
+      //Residue is full, retire the oldest range as half cycle
+      CountRange(stack[0], stack[1], 1);
+      for (int i = 1; i < stackSize; i++)
+         stack[i - 1] = stack[i];
+      stackSize--;
+   }
+
+   stack[stackSize++] = soc;
+
+   while (stackSize >= 3)
+   {
+      float x = ABS(stack[stackSize - 1] - stack[stackSize - 2]);
+      float y = ABS(stack[stackSize - 2] - stack[stackSize - 3]);
+
+      if (x < y) break;
+
+      if (stackSize == 3)
+      {
+         //Range contains the starting point, count as half cycle and drop the start
+         CountRange(stack[0], stack[1], 1);
+         stack[0] = stack[1];
+         stack[1] = stack[2];
+         stackSize = 2;
+      }
+      else
+      {
+         CountRange(stack[stackSize - 3], stack[stackSize - 2], 2);
+         stack[stackSize - 3] = stack[stackSize - 1];
+         stackSize -= 2;
+      }
+   }
+}
+
+void CycleCounter::CountRange(float from, float to, int halfCycles)
+{
+   float depth = ABS(to - from);
+   float mean = (from + to) / 2;
+   int depthBin = MIN((int)(depth / (100 / CC_DEPTH_BINS)), CC_DEPTH_BINS - 1);
+   int meanBin = MIN((int)(mean / (100 / CC_MEAN_BINS)), CC_MEAN_BINS - 1);
+
+   depthBin = MAX(depthBin, 0);
+   meanBin = MAX(meanBin, 0);
+
+   data.halfCycles[meanBin * CC_DEPTH_BINS + depthBin] += halfCycles;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "energycounter.h"
+
+EnergyCounter::Counter EnergyCounter::in;
+EnergyCounter::Counter EnergyCounter::out;
+
+/** \brief Adds the charge counted since the last call
+ *
+ * \param chargeIn charge into the battery in As
+ * \param chargeOut charge out of the battery in As
+ * \param voltage pack voltage in V
+ */
+void EnergyCounter::Add(float chargeIn, float chargeOut, float voltage)
+{
+   Add(in, chargeIn * voltage);
+   Add(out, chargeOut * voltage);
+}
+
+/** \brief Sets the totals, e.g. after restoring them from flash
+ *
+ * \param kWhIn energy into the battery in kWh
+ * \param kWhOut energy out of the battery in kWh
+ */
+void EnergyCounter::SetTotals(float kWhIn, float kWhOut)
+{
+   Set(in, kWhIn);
+   Set(out, kWhOut);
+}
+
+void EnergyCounter::Add(Counter& c, float ws)
+{
+   c.wattSeconds += ws;
+
+   if (c.wattSeconds >= 3600)
+   {
+      uint32_t wh = c.wattSeconds / 3600;
+      c.wattHours += wh;
+      c.wattSeconds -= wh * 3600.0f;
+   }
+
+   c.total = (c.wattHours + c.wattSeconds / 3600) / 1000;
+}
+
+void EnergyCounter::Set(Counter& c, float kWh)
+{
+   float wh = kWh > 0 ? kWh * 1000 : 0;
+
+   c.wattHours = wh;
+   c.wattSeconds = (wh - c.wattHours) * 3600;
+   c.total = kWh > 0 ? kWh : 0;
+}
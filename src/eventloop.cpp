@@ -0,0 +1,72 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/cm3/cortex.h>
+#include "eventloop.h"
+#include "timebase.h"
+
+#define SDO_REQUEST_BASE 0x600 //Client to server SDO, + node id
+
+volatile uint32_t EventLoop::pending = 0;
+volatile uint32_t EventLoop::postTime[EV_LAST];
+volatile uint32_t EventLoop::sleepTicks = 0;
+
+/** \brief Marks an event pending, safe to call from any interrupt priority
+ * \param ev event to post
+ */
+void EventLoop::Post(Event ev)
+{
+   uint32_t mask = 1 << ev;
+   uint32_t now = TimeBase::GetCycles();
+
+   //Only the first post of a batch sets the time stamp
+   if ((__atomic_fetch_or(&pending, mask, __ATOMIC_SEQ_CST) & mask) == 0)
+      postTime[ev] = now;
+}
+
+/** \brief Returns and clears all pending events
+ * \return bit mask of events, check with IsSet()
+ */
+uint32_t EventLoop::Take()
+{
+   return __atomic_exchange_n(&pending, 0, __ATOMIC_SEQ_CST);
+}
+
+/** \brief Sleeps until an interrupt posts an event or one is already pending
+ * WFI wakes on pending interrupts even while they are masked. Masking them
+ * around the check closes the window between the check and going to sleep,
+ * they are serviced right after re-enabling.
+ */
+void EventLoop::WaitForEvent()
+{
+   cm_disable_interrupts();
+   if (pending == 0)
+   {
+      uint32_t start = TimeBase::GetTicks();
+      __asm__ volatile("wfi");
+      //The interrupt that woke us hasn't run yet, so this is pure sleep time
+      sleepTicks += (TimeBase::GetTicks() - start) & TIMEBASE_TICK_MASK;
+   }
+   cm_enable_interrupts();
+}
+
+void SdoEventSource::HandleRx(uint32_t canId, uint32_t*, uint8_t)
+{
+   if ((canId & ~0x7F) == SDO_REQUEST_BASE)
+      EventLoop::Post(EventLoop::EV_SDO);
+}
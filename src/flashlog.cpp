@@ -0,0 +1,159 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/crc.h>
+#include "flashlog.h"
+#include "flashstore.h"
+#include "hwdefs.h"
+
+#define LOG_MAGIC   0x474F4C46 //"FLOG"
+#define PAGE_WORDS  (FLASH_PAGE_SIZE / sizeof(uint32_t))
+#define HEADER_WORDS 2 //magic, sequence
+#define ERASED      0xFFFFFFFF
+
+/** \brief Creates a log in two consecutive flash blocks
+ * \param blockNum first of the two flash blocks, counted from the end of flash, see hwdefs.h
+ */
+FlashLog::FlashLog(int blockNum)
+   : firstBlock(blockNum), activePage(-1), sequence(0), offset(PAGE_WORDS)
+{
+}
+
+/** \brief Finds the newest valid page and replays its records
+ *
+ * \param handler called for every valid record in order
+ * \return true if a valid page was found
+ *
+ */
+bool FlashLog::Open(RecordHandler handler)
+{
+   activePage = -1;
+   offset = PAGE_WORDS;
+
+   for (int page = 0; page < 2; page++)
+   {
+      const uint32_t* words = (const uint32_t*)GetPageAddress(page);
+
+      if (words[0] == LOG_MAGIC && (activePage < 0 || (int32_t)(words[1] - sequence) > 0))
+      {
+         activePage = page;
+         sequence = words[1];
+      }
+   }
+
+   if (activePage < 0) return false;
+
+   const uint32_t* words = (const uint32_t*)GetPageAddress(activePage);
+   offset = HEADER_WORDS;
+
+   while (offset < (int)PAGE_WORDS && words[offset] != ERASED)
+   {
+      int length = words[offset] & 0xFFFF;
+
+      if ((offset + length + 2) > (int)PAGE_WORDS) break;
+
+      crc_reset();
+      uint32_t crc = crc_calculate_block((uint32_t*)&words[offset], length + 1);
+
+      //Torn write, don't append behind it
+      if (crc != words[offset + length + 1]) break;
+
+      handler(words[offset] >> 16, &words[offset + 1], length);
+      offset += length + 2;
+   }
+
+   if (offset < (int)PAGE_WORDS && words[offset] != ERASED)
+      offset = PAGE_WORDS;
+
+   return true;
+}
+
+/** \brief Appends a record to the active page
+ * \return false if it doesn't fit, call StartPage() with a snapshot instead
+ */
+bool FlashLog::Append(uint16_t type, const uint32_t* data, int words)
+{
+   if (activePage < 0 || words + 2 > GetFreeWords()) return false;
+
+   offset += WriteRecord(GetPageAddress(activePage) + offset * sizeof(uint32_t), type, data, words);
+   return true;
+}
+
+/** \brief Erases the inactive page, writes the snapshot record and makes it the active page
+ * Note that the CPU stalls while the page is erased.
+ */
+void FlashLog::StartPage(uint16_t type, const uint32_t* data, int words)
+{
+   int page = activePage < 0 ? 0 : activePage ^ 1;
+   uint32_t address = GetPageAddress(page);
+
+   if (words + 2 + HEADER_WORDS > (int)PAGE_WORDS) return;
+
+   flash_unlock();
+   flash_erase_page(address);
+   flash_lock();
+
+   offset = HEADER_WORDS + WriteRecord(address + HEADER_WORDS * sizeof(uint32_t), type, data, words);
+
+   //The page only becomes valid once its snapshot is complete
+   flash_unlock();
+   flash_program_word(address + sizeof(uint32_t), sequence + 1);
+   flash_program_word(address, LOG_MAGIC);
+   flash_lock();
+
+   sequence++;
+   activePage = page;
+}
+
+/** \brief Returns the free space in the active page, including record overhead */
+int FlashLog::GetFreeWords()
+{
+   return activePage < 0 ? 0 : PAGE_WORDS - offset;
+}
+
+uint32_t FlashLog::GetPageAddress(int page)
+{
+   return FlashStore::GetBlockAddress(firstBlock + page);
+}
+
+/** \brief Programs one record, the CRC is calculated from the words as they are written
+ * \return number of words written
+ */
+int FlashLog::WriteRecord(uint32_t address, uint16_t type, const uint32_t* data, int words)
+{
+   uint32_t header = ((uint32_t)type << 16) | words;
+   uint32_t crc;
+
+   flash_unlock();
+   crc_reset();
+   crc = crc_calculate(header);
+   flash_program_word(address, header);
+
+   for (int i = 0; i < words; i++)
+   {
+      uint32_t word = data[i];
+      crc = crc_calculate(word);
+      flash_program_word(address + (i + 1) * sizeof(uint32_t), word);
+   }
+
+   flash_program_word(address + (words + 1) * sizeof(uint32_t), crc);
+   flash_lock();
+
+   return words + 2;
+}
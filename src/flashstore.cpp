@@ -0,0 +1,91 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/crc.h>
+#include <libopencm3/stm32/desig.h>
+#include <libopencm3/stm32/memorymap.h>
+#include "flashstore.h"
+#include "hwdefs.h"
+
+/** \brief Loads a CRC protected data block from flash
+ *
+ * \param blockNum flash page counted from the end of flash, see hwdefs.h
+ * \param data destination, left untouched when the CRC doesn't match
+ * \param numWords number of 32-bit words to load
+ * \return true if valid data was found
+ *
+ */
+bool FlashStore::Load(int blockNum, uint32_t* data, int numWords)
+{
+   const uint32_t* flashData = (const uint32_t*)GetBlockAddress(blockNum);
+
+   if ((numWords + 1) * sizeof(uint32_t) > FLASH_PAGE_SIZE) return false;
+
+   crc_reset();
+   uint32_t crc = crc_calculate_block((uint32_t*)flashData, numWords);
+
+   if (crc != flashData[numWords]) return false;
+
+   for (int i = 0; i < numWords; i++)
+      data[i] = flashData[i];
+
+   return true;
+}
+
+/** \brief Stores a data block to flash followed by its CRC
+ *
+ * The page is only erased and written when the content has changed.
+ * Note that the CPU stalls while the page is erased.
+ *
+ * \param blockNum flash page counted from the end of flash, see hwdefs.h
+ * \param data data to store
+ * \param numWords number of 32-bit words to store
+ * \return true if the page was written
+ *
+ */
+bool FlashStore::Save(int blockNum, const uint32_t* data, int numWords)
+{
+   uint32_t baseAddress = GetBlockAddress(blockNum);
+   const uint32_t* flashData = (const uint32_t*)baseAddress;
+
+   if ((numWords + 1) * sizeof(uint32_t) > FLASH_PAGE_SIZE) return false;
+
+   crc_reset();
+   uint32_t crc = crc_calculate_block((uint32_t*)data, numWords);
+
+   if (crc == flashData[numWords]) return false; //Nothing has changed
+
+   flash_unlock();
+   flash_erase_page(baseAddress);
+
+   for (int i = 0; i < numWords; i++)
+      flash_program_word(baseAddress + i * sizeof(uint32_t), data[i]);
+
+   flash_program_word(baseAddress + numWords * sizeof(uint32_t), crc);
+   flash_lock();
+
+   return true;
+}
+
+uint32_t FlashStore::GetBlockAddress(int blockNum)
+{
+   uint32_t flashSize = desig_get_flash_size();
+
+   return FLASH_BASE + flashSize * 1024 - blockNum * FLASH_PAGE_SIZE;
+}
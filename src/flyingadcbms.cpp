@@ -21,6 +21,7 @@
 #include "flyingadcbms.h"
 #include "digio.h"
 #include "hwdefs.h"
+#include "trace.h"
 
 #define READ            true
 #define WRITE           false
@@ -162,7 +163,12 @@ FlyingAdcBms::BalanceStatus FlyingAdcBms::SetBalancing(BalanceCommand cmd)
 
 void FlyingAdcBms::SendRecvI2C(uint8_t address, bool read, uint8_t* data, uint8_t len)
 {
-   if (lock) return;
+   if (lock)
+   {
+      //Bus is in use by an interrupted transfer
+      Trace::Add(Trace::TR_I2C, address, len);
+      return;
+   }
 
    lock = true;
 
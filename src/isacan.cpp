@@ -0,0 +1,95 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "isacan.h"
+
+#define STATUS_ERROR_MASK 0x70 //Measurement, system or channel error
+
+IsaCan::IsaCan(CanHardware* hw)
+   : can(hw), currentHandler(0), cyclePeriod(10), lastCounter(-1), current(0), temperature(0), power(0),
+     charge(0), energy(0), errorFrames(0)
+{
+   voltage[0] = voltage[1] = voltage[2] = 0;
+   can->AddCallback(this);
+   HandleClear();
+}
+
+void IsaCan::HandleClear()
+{
+   //All result messages in one filter
+   can->RegisterUserMessage(ISA_ID_CURRENT & ~0xF, 0x7F0);
+}
+
+void IsaCan::HandleRx(uint32_t canId, uint32_t data[2], uint8_t)
+{
+   uint8_t status = (data[0] >> 8) & 0xFF;
+
+   if (canId < ISA_ID_CURRENT || canId > ISA_ID_ENERGY) return;
+
+   if (status & STATUS_ERROR_MASK)
+   {
+      errorFrames++;
+      return;
+   }
+
+   switch (canId)
+   {
+   case ISA_ID_CURRENT:
+   {
+      int8_t counter = status & 0xF;
+      int8_t steps = (counter - lastCounter) & 0xF;
+
+      current = GetValue(data);
+
+      //The first frame only starts the time base
+      if (lastCounter >= 0 && steps > 0 && currentHandler != 0)
+         currentHandler(GetCurrent(), (steps * cyclePeriod) / 1000.0f);
+
+      lastCounter = counter;
+      break;
+   }
+   case ISA_ID_U1:
+   case ISA_ID_U2:
+   case ISA_ID_U3:
+      voltage[canId - ISA_ID_U1] = GetValue(data);
+      break;
+   case ISA_ID_TEMP:
+      temperature = GetValue(data);
+      break;
+   case ISA_ID_POWER:
+      power = GetValue(data);
+      break;
+   case ISA_ID_CHARGE:
+      charge = GetValue(data);
+      break;
+   case ISA_ID_ENERGY:
+      energy = GetValue(data);
+      break;
+   }
+}
+
+/** \brief Extracts the big endian 32 bit result from bytes 2 to 5 */
+int32_t IsaCan::GetValue(const uint32_t data[2])
+{
+   uint32_t value = ((data[0] >> 16) & 0xFF) << 24;
+   value |= ((data[0] >> 24) & 0xFF) << 16;
+   value |= (data[1] & 0xFF) << 8;
+   value |= (data[1] >> 8) & 0xFF;
+
+   return (int32_t)value;
+}
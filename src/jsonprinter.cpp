@@ -0,0 +1,92 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "jsonprinter.h"
+#include "printf.h"
+
+CanMap* JsonPrinter::canMap = 0;
+IPutChar* JsonPrinter::output = 0;
+uint16_t JsonPrinter::index = 0;
+bool JsonPrinter::hidden = false;
+char JsonPrinter::comma = ' ';
+
+/** \brief Starts a new dump, an unfinished one is abandoned
+ * \param out character sink, usually the CanSdo print buffer
+ * \param printHidden also print parameters flagged hidden
+ */
+void JsonPrinter::Start(IPutChar* out, bool printHidden)
+{
+   output = out;
+   index = 0;
+   hidden = printHidden;
+   comma = ' ';
+   fprintf(output, "{");
+}
+
+/** \brief Prints the next visible parameter
+ * \return true while there is more to print
+ */
+bool JsonPrinter::Run()
+{
+   if (output == 0) return false;
+
+   while (index < Param::PARAM_LAST)
+   {
+      Param::PARAM_NUM idx = (Param::PARAM_NUM)index++;
+
+      if ((Param::GetFlag(idx) & Param::FLAG_HIDDEN) == 0 || hidden)
+      {
+         PrintEntry(idx);
+         return true;
+      }
+   }
+
+   fprintf(output, "\r\n}\r\n");
+   output = 0;
+   return false;
+}
+
+void JsonPrinter::PrintEntry(Param::PARAM_NUM idx)
+{
+   const Param::Attributes* pAtr = Param::GetAttrib(idx);
+   uint32_t canId;
+   uint8_t canStart;
+   int8_t canLength, canOffset;
+   float canGain;
+   bool isRx;
+
+   //libopeninv printf formats %f from fixed point
+   fprintf(output, "%c\r\n   \"%s\": {\"unit\":\"%s\",\"value\":%f,", comma, pAtr->name, pAtr->unit, Param::Get(idx));
+
+   if (canMap != 0 && canMap->FindMap(idx, canId, canStart, canLength, canGain, canOffset, isRx))
+   {
+      fprintf(output, "\"canid\":%d,\"canoffset\":%d,\"canlength\":%d,\"cangain\":%f,\"isrx\":%s,",
+              canId, canStart, canLength, FP_FROMFLT(canGain), isRx ? "true" : "false");
+   }
+
+   if (pAtr->type != Param::TYPE_SPOTVALUE)
+   {
+      fprintf(output, "\"isparam\":true,\"minimum\":%f,\"maximum\":%f,\"default\":%f,\"category\":\"%s\",\"i\":%d}",
+              pAtr->min, pAtr->max, pAtr->def, pAtr->category, idx);
+   }
+   else
+   {
+      fprintf(output, "\"isparam\":false}");
+   }
+   comma = ',';
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lifetimestats.h"
+#include "my_math.h"
+
+#define TEMP_BIN_OFFSET (LS_CELLS * LS_VOLTAGE_BINS)
+
+LifetimeStats::Data LifetimeStats::data;
+uint16_t LifetimeStats::delta[LS_BINS];
+//Upper bin edges, the last bin takes everything above
+const int16_t LifetimeStats::voltageEdges[LS_VOLTAGE_BINS - 1] = { 3000, 3300, 3500, 3700, 3900, 4100, 4200 }; //mV
+const int16_t LifetimeStats::tempEdges[LS_TEMP_BINS - 1] = { -10, 0, 10, 25, 35, 45, 55 }; //°C
+
+/** \brief Adds time at the present cell voltages
+ *
+ * \param voltages cell voltages in mV
+ * \param numCells number of valid entries in voltages
+ * \param seconds time since the last call
+ *
+ */
+void LifetimeStats::AddCells(const float* voltages, int numCells, uint16_t seconds)
+{
+   int16_t umin = INT16_MAX, umax = INT16_MIN;
+
+   numCells = MIN(numCells, LS_CELLS);
+
+   for (int i = 0; i < numCells; i++)
+   {
+      int16_t u = voltages[i];
+      AddTime(i * LS_VOLTAGE_BINS + FindBin(voltageEdges, LS_VOLTAGE_BINS - 1, u), seconds);
+      umin = MIN(umin, u);
+      umax = MAX(umax, u);
+   }
+
+   if (numCells > 0)
+      UpdateExtremes(EX_UMIN, umin, umax);
+}
+
+/** \brief Adds time at the present module temperature
+ *
+ * \param tempmin lowest sensor temperature in °C
+ * \param tempmax highest sensor temperature in °C, selects the bin
+ * \param seconds time since the last call
+ *
+ */
+void LifetimeStats::AddTemperature(float tempmin, float tempmax, uint16_t seconds)
+{
+   AddTime(TEMP_BIN_OFFSET + FindBin(tempEdges, LS_TEMP_BINS - 1, tempmax), seconds);
+   UpdateExtremes(EX_TEMPMIN, tempmin, tempmax);
+}
+
+/** \brief Tracks the peak charge and discharge current
+ * \param current current in A, positive when charging
+ */
+void LifetimeStats::AddCurrent(float current)
+{
+   int16_t i = current;
+   UpdateExtremes(EX_IDCMIN, i, i);
+}
+
+uint32_t LifetimeStats::GetVoltageTime(int cell, int bin)
+{
+   if (cell < 0 || cell >= LS_CELLS || bin < 0 || bin >= LS_VOLTAGE_BINS) return 0;
+   return data.time[cell * LS_VOLTAGE_BINS + bin];
+}
+
+uint32_t LifetimeStats::GetTemperatureTime(int bin)
+{
+   if (bin < 0 || bin >= LS_TEMP_BINS) return 0;
+   return data.time[TEMP_BIN_OFFSET + bin];
+}
+
+int32_t LifetimeStats::GetExtreme(Extreme e)
+{
+   return e < EX_LAST ? data.extremes[e] : 0;
+}
+
+/** \brief Builds a record of everything that changed since the last call
+ *
+ * The record starts with the extremes, followed by one word per changed bin:
+ * bin index << 16 | seconds.
+ *
+ * \param[out] record destination with room for LS_DELTA_WORDS words
+ * \return number of words used, LS_EXTREME_WORDS means no bin has changed
+ *
+ */
+int LifetimeStats::TakeDelta(uint32_t* record)
+{
+   int words = 0;
+
+   for (int i = 0; i < EX_LAST; i += 2)
+      record[words++] = (uint16_t)data.extremes[i] | ((uint32_t)(uint16_t)data.extremes[i + 1] << 16);
+
+   for (int i = 0; i < LS_BINS; i++)
+   {
+      if (delta[i] > 0)
+      {
+         record[words++] = (i << 16) | delta[i];
+         delta[i] = 0;
+      }
+   }
+   return words;
+}
+
+/** \brief Adds a record from TakeDelta() to the totals
+ * \return false if the record is malformed
+ */
+bool LifetimeStats::ApplyDelta(const uint32_t* record, int words)
+{
+   if (words < LS_EXTREME_WORDS) return false;
+
+   for (int i = 0; i < EX_LAST; i += 2)
+   {
+      data.extremes[i] = record[i / 2] & 0xFFFF;
+      data.extremes[i + 1] = record[i / 2] >> 16;
+   }
+
+   for (int i = LS_EXTREME_WORDS; i < words; i++)
+   {
+      uint32_t idx = record[i] >> 16;
+
+      if (idx < LS_BINS)
+         data.time[idx] += record[i] & 0xFFFF;
+   }
+   return true;
+}
+
+/** \brief Forgets the changes since the last TakeDelta(), call after saving a snapshot */
+void LifetimeStats::ClearDelta()
+{
+   for (int i = 0; i < LS_BINS; i++)
+      delta[i] = 0;
+}
+
+/** \brief Restores the totals from a copy of GetStorage()
+ * \return false if the size doesn't match
+ */
+bool LifetimeStats::Load(const uint32_t* snapshot, int words)
+{
+   if (words != GetStorageWords()) return false;
+
+   uint32_t* storage = (uint32_t*)&data;
+
+   for (int i = 0; i < words; i++)
+      storage[i] = snapshot[i];
+
+   ClearDelta();
+   return true;
+}
+
+void LifetimeStats::Reset()
+{
+   for (int i = 0; i < LS_BINS; i++)
+      data.time[i] = 0;
+
+   for (int i = 0; i < EX_LAST; i += 2)
+   {
+      data.extremes[i] = INT16_MAX;
+      data.extremes[i + 1] = INT16_MIN;
+   }
+   ClearDelta();
+}
+
+int LifetimeStats::FindBin(const int16_t* edges, int numEdges, int value)
+{
+   int bin = 0;
+
+   while (bin < numEdges && value >= edges[bin]) bin++;
+
+   return bin;
+}
+
+void LifetimeStats::AddTime(int idx, uint16_t seconds)
+{
+   data.time[idx] += seconds;
+   //Saturate rather than wrap, deltas are taken long before this
+   delta[idx] = MIN((uint32_t)delta[idx] + seconds, UINT16_MAX);
+}
+
+/** \brief Widens a min/max pair of extremes, the max entry directly follows the min entry */
+void LifetimeStats::UpdateExtremes(Extreme low, int16_t minValue, int16_t maxValue)
+{
+   data.extremes[low] = MIN(data.extremes[low], minValue);
+   data.extremes[low + 1] = MAX(data.extremes[low + 1], maxValue);
+}
@@ -0,0 +1,149 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "liveness.h"
+
+#define LATE_MARGIN_MS 50 //Allows for the 10 ms scheduler and bus arbitration
+#define STAT_MAX       0xFFFF
+
+Liveness::Module Liveness::modules[MAX_MODULES];
+uint32_t Liveness::lostMask = 0;
+uint32_t Liveness::period = 1000;
+uint8_t Liveness::numModules = 0;
+
+static void Increment(uint16_t& stat, uint16_t amount = 1)
+{
+   stat = stat > (STAT_MAX - amount) ? STAT_MAX : stat + amount;
+}
+
+/** \brief Clears all statistics, e.g. after enumeration
+ *
+ * \param count number of modules in the chain, module 0 is ourselves and not monitored
+ * \param periodMs interval at which the modules send their PDO at the latest
+ * \param timeMs current time
+ *
+ */
+void Liveness::Reset(uint8_t count, uint32_t periodMs, uint32_t timeMs)
+{
+   numModules = count < MAX_MODULES ? count : MAX_MODULES;
+   period = periodMs;
+   lostMask = 0;
+
+   for (int i = 0; i < MAX_MODULES; i++)
+   {
+      modules[i] = Module();
+      modules[i].lastRx = timeMs;
+   }
+}
+
+/** \brief Processes the sequence counter of a received module PDO
+ *
+ * \param mod module index
+ * \param counter 2 bit sequence counter from the frame
+ * \param timeMs receive time stamp
+ *
+ */
+void Liveness::Receive(uint8_t mod, uint8_t counter, uint32_t timeMs)
+{
+   if (mod == 0 || mod >= numModules) return;
+
+   Module& m = modules[mod];
+   uint32_t gap = timeMs - m.lastRx;
+   uint8_t step = (counter - m.lastCounter) & 0x3;
+
+   Increment(m.stats[RECEIVED]);
+
+   if (m.seen && (lostMask & (1 << mod)) == 0)
+   {
+      if (step == 0)
+         Increment(m.stats[DUPLICATE]);
+      else if (step > 1)
+         Increment(m.stats[MISSED], step - 1);
+
+      if (gap > (period + LATE_MARGIN_MS))
+         Increment(m.stats[LATE]);
+
+      if (gap > m.stats[MAXGAP])
+         m.stats[MAXGAP] = gap > STAT_MAX ? STAT_MAX : gap;
+   }
+
+   //A module coming back after being lost restarts its sequence
+   lostMask &= ~(1 << mod);
+   m.seen = true;
+   m.lastCounter = counter;
+   m.lastRx = timeMs;
+}
+
+/** \brief Restarts the sequence of a module that restarted or joined the chain, statistics are kept
+ *
+ * \param mod module index, may be one past the current chain
+ * \param timeMs current time
+ *
+ */
+void Liveness::Readmit(uint8_t mod, uint32_t timeMs)
+{
+   if (mod == 0 || mod >= MAX_MODULES) return;
+
+   if (mod >= numModules)
+      numModules = mod + 1;
+
+   lostMask &= ~(1 << mod);
+   modules[mod].seen = false;
+   modules[mod].lastRx = timeMs;
+}
+
+/** \brief Marks modules lost that have been silent for too long
+ *
+ * \param timeMs current time
+ * \param lostPeriods number of heartbeat periods after which a silent module is lost
+ * \return number of lost modules
+ *
+ */
+int Liveness::Run(uint32_t timeMs, uint8_t lostPeriods)
+{
+   int lost = 0;
+
+   for (int i = 1; i < numModules; i++)
+   {
+      //Signed, a frame may have arrived after timeMs was taken
+      if ((int32_t)(timeMs - modules[i].lastRx) > (int32_t)(period * lostPeriods))
+      {
+         if ((lostMask & (1 << i)) == 0)
+            Increment(modules[i].stats[LOST]);
+
+         lostMask |= 1 << i;
+         lost++;
+      }
+   }
+   return lost;
+}
+
+/** \brief Sums a statistic over all modules, for MAXGAP the maximum is returned */
+uint32_t Liveness::GetTotal(Stat stat)
+{
+   uint32_t total = 0;
+
+   for (int i = 1; i < numModules; i++)
+   {
+      if (stat == MAXGAP)
+         total = total > modules[i].stats[stat] ? total : modules[i].stats[stat];
+      else
+         total += modules[i].stats[stat];
+   }
+   return total;
+}
@@ -17,11 +17,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdint.h>
+#include <string.h>
 #include <libopencm3/stm32/usart.h>
 #include <libopencm3/stm32/rtc.h>
 #include <libopencm3/stm32/can.h>
 #include <libopencm3/stm32/iwdg.h>
 #include <libopencm3/stm32/f1/bkp.h>
+#include <libopencm3/cm3/cortex.h>
 #include "stm32_can.h"
 #include "canmap.h"
 #include "cansdo.h"
@@ -43,6 +45,28 @@
 #include "bmsalgo.h"
 #include "bmsio.h"
 #include "selftest.h"
+#include "selfdischarge.h"
+#include "bmssdo.h"
+#include "cyclecounter.h"
+#include "flashstore.h"
+#include "thermalmodel.h"
+#include "timepredictor.h"
+#include "cellstream.h"
+#include "timebase.h"
+#include "pdoscheduler.h"
+#include "packaggregator.h"
+#include "liveness.h"
+#include "currentframe.h"
+#include "isacan.h"
+#include "taskprofiler.h"
+#include "eventloop.h"
+#include "jsonprinter.h"
+#include "trace.h"
+#include "lifetimestats.h"
+#include "flashlog.h"
+#include "capture.h"
+#include "statejournal.h"
+#include "energycounter.h"
 
 #define PRINT_JSON 0
 
@@ -51,36 +75,234 @@ static CanMap* canMapExternal;
 static CanMap* canMapInternal;
 static BmsFsm* bmsFsm;
 static CanSdo* canSdo;
+static IsaCan* isaCan;
+static volatile bool lowPower = false;
+static ThermalModel thermalModels[MAX_MODULES];
+static FlashLog statsLog(STATS_BLKNUM);
+static FlashLog stateLog(STATE_BLKNUM);
+static StateJournal::State savedState; //State of the last flash journal record
+static uint16_t stateSequence = 0;
+static bool estimatorRestored = false;
+static float estimatedSoc = 0, estimatedSocAtValidSoh = -1, asDiffAfterEstimate = 0;
+static volatile uint32_t* const journalRegs[JOURNAL_BACKUP_WORDS] =
+   { &BKP_DR4, &BKP_DR5, &BKP_DR6, &BKP_DR7, &BKP_DR8, &BKP_DR9, &BKP_DR10 };
 HwRev hwRev;
 
-static void CalculateCurrentLimits()
+#define IDLE_CURRENT_DIVIDER  4 //Sample current every 20 ms in low power IDLE
+#define IDLE_CELL_DIVIDER     8 //Measure one cell every 200 ms in low power IDLE
+#define LIMIT_TRACE_STEP      5 //A
+#define STATS_SAVE_INTERVAL   3600 //s
+#define CYCLES_SAVE_INTERVAL  3600000 //ms, every save erases the cycle counter page
+#define STATE_SAVE_INTERVAL   600 //s, the backup registers cover the time in between
+#define FLASH_WRITE_GAP       200 //ms between two flash writes
+
+//Task indexes for TaskProfiler, the tXXXavg/tXXXmax values follow this order
+enum ProfiledTask { PROF_MS5, PROF_CELLS, PROF_MUX, PROF_MS100 };
+
+/** \brief Traces limit changes of at least LIMIT_TRACE_STEP and any change to or from 0
+ * \param which 0 for the charge limit, 1 for the discharge limit
+ * \param limit new limit in A
+ */
+static void TraceLimit(int which, float limit)
+{
+   static int16_t lastLimit[2] = { -1, -1 };
+   int16_t current = (int16_t)limit;
+
+   if (ABS(current - lastLimit[which]) >= LIMIT_TRACE_STEP || ((current == 0) != (lastLimit[which] == 0)))
+   {
+      Trace::Add(Trace::TR_LIMIT, which, current);
+      lastLimit[which] = current;
+   }
+}
+
+/** \brief Calculates charge and discharge current limits
+ * \return temperature derating factor of the charge current
+ */
+static float CalculateCurrentLimits()
 {
    float chargeCurrentLimit = BmsAlgo::GetChargeCurrent(Param::GetFloat(Param::umax),
                                                         Param::GetFloat(Param::ucellhyst),
-                                                        Param::GetFloat(Param::icutoff));
-   chargeCurrentLimit *= BmsAlgo::LowTemperatureDerating(Param::GetFloat(Param::tempmin));
-   chargeCurrentLimit *= BmsAlgo::HighTemperatureDerating(Param::GetFloat(Param::tempmax), 50);
+                                                        Param::GetFloat(Param::icutoff),
+                                                        Param::GetFloat(Param::tempmin));
+   float highTemp = Param::GetFloat(Param::tempmax);
+
+   //The surface sensors lag behind the core under high current, derate on the predicted core temperature
+   if (Param::GetBool(Param::tempmodel))
+      highTemp = MAX(highTemp, Param::GetFloat(Param::tcoremax));
+
+   float chargeDerating = BmsAlgo::LowTemperatureDerating(Param::GetFloat(Param::tempmin));
+   chargeDerating *= BmsAlgo::HighTemperatureDerating(highTemp, 50);
+   chargeCurrentLimit *= chargeDerating;
    Param::SetFloat(Param::chargelim, chargeCurrentLimit);
 
    float dischargeCurrentLimit = BmsAlgo::LimitMinimumCellVoltage(Param::GetFloat(Param::umin));
-   dischargeCurrentLimit *= BmsAlgo::HighTemperatureDerating(Param::GetFloat(Param::tempmax), 53);
+   dischargeCurrentLimit *= BmsAlgo::HighTemperatureDerating(highTemp, 53);
+
+   //Without data from all modules we can't tell whether a cell is at its limit
+   if (Param::GetInt(Param::stalemods) > 0)
+   {
+      Param::SetFloat(Param::chargelim, 0);
+      dischargeCurrentLimit = 0;
+   }
    Param::SetFloat(Param::dischargelim, dischargeCurrentLimit);
+   TraceLimit(0, Param::GetFloat(Param::chargelim));
+   TraceLimit(1, dischargeCurrentLimit);
 /*
    if (Param::GetFloat(Param::umax) < (Param::GetFloat(Param::ucellmax) - 50))
       DigIo::nextena_out.Set();
    else if (Param::GetFloat(Param::umax) >= Param::GetFloat(Param::ucellmax))
       DigIo::nextena_out.Clear();*/
+   return chargeDerating;
+}
+
+static void CheckModuleFreshness()
+{
+   static int lastStale = 0;
+   int stale = PackAggregator::CheckFreshness(TimeBase::GetMillis(), Param::GetInt(Param::modtimeout));
+
+   if (stale > 0 && lastStale == 0)
+   {
+      ErrorMessage::Post(ERR_MODULE_STALE);
+      Param::SetInt(Param::lasterr, ERR_MODULE_STALE);
+   }
+
+   lastStale = stale;
+   Param::SetInt(Param::stalemods, stale);
+}
+
+static void RunLivenessMonitor()
+{
+   int lost = Liveness::Run(TimeBase::GetMillis(), Param::GetInt(Param::lostperiods));
+   uint32_t received = Liveness::GetTotal(Liveness::RECEIVED);
+   uint32_t missed = Liveness::GetTotal(Liveness::MISSED);
+
+   Param::SetInt(Param::modlost, lost);
+   Param::SetInt(Param::canmissed, missed);
+   Param::SetInt(Param::candup, Liveness::GetTotal(Liveness::DUPLICATE));
+   Param::SetInt(Param::canlate, Liveness::GetTotal(Liveness::LATE));
+
+   if ((received + missed) > 0)
+      Param::SetFloat(Param::canqual, (100.0f * received) / (received + missed));
+   else
+      Param::SetInt(Param::canqual, 100);
+}
+
+static void RunIsaCan()
+{
+   if (Param::GetInt(Param::idcmode) != IDC_ISACAN) return;
+
+   Param::SetFloat(Param::isau1, isaCan->GetVoltage(0));
+   Param::SetFloat(Param::isaah, isaCan->GetCharge() / 3600);
+   Param::SetFloat(Param::isakwh, isaCan->GetEnergy() / 1000);
+}
+
+/** \brief Decides whether we can run at reduced rate
+ * Balancing needs the full cell task rate, its timing is based on 25 ms calls
+ */
+static void UpdateLowPower(BmsFsm::bmsstate stt)
+{
+   lowPower = Param::GetBool(Param::lowpower) && stt == BmsFsm::IDLE && !BmsIO::IsBalancing() &&
+              ABS(Param::GetFloat(Param::idc)) < Param::GetFloat(Param::idlethresh);
+}
+
+/** \brief Reports the share of time the CPU is awake
+ * Both the elapsed and the sleeping time are counted in SysTick ticks,
+ * the DWT cycle counter stops during WFI.
+ */
+static void MeasureCpuDuty()
+{
+   static uint32_t lastTicks = 0, lastSleep = 0;
+   uint32_t ticks = TimeBase::GetTicks();
+   uint32_t sleep = EventLoop::GetSleepTicks();
+   uint32_t total = (ticks - lastTicks) & TIMEBASE_TICK_MASK;
+   uint32_t busy = total - MIN(sleep - lastSleep, total);
+
+   lastTicks = ticks;
+   lastSleep = sleep;
+
+   if (total > 0)
+      Param::SetFloat(Param::cpuduty, (100.0f * busy) / total);
+}
+
+static void PublishTaskProfile()
+{
+   int late = 0, overrun = 0;
+
+   for (int i = PROF_MS5; i <= PROF_MS100; i++)
+   {
+      Param::SetFloat((Param::PARAM_NUM)(Param::tms5avg + 2 * i), TaskProfiler::GetMicros(i, TaskProfiler::AVG));
+      Param::SetFloat((Param::PARAM_NUM)(Param::tms5max + 2 * i), TaskProfiler::GetMicros(i, TaskProfiler::MAX));
+      late += TaskProfiler::GetStat(i, TaskProfiler::LATE);
+      overrun += TaskProfiler::GetStat(i, TaskProfiler::OVERRUN);
+   }
+
+   Param::SetInt(Param::tlate, late);
+   Param::SetInt(Param::toverrun, overrun);
+}
+
+static void RunTimePrediction(float chargeDerating)
+{
+   static float avgPower = 0;
+   float soc = Param::GetFloat(Param::soc);
+
+   avgPower = IIRFILTERF(avgPower, Param::GetFloat(Param::power), 6);
+
+   TimePredictor::Run(soc, Param::GetFloat(Param::tempmin), chargeDerating);
+   Param::SetFloat(Param::ttarget, TimePredictor::GetTimeToTarget());
+   Param::SetFloat(Param::tfull, TimePredictor::GetTimeToFull());
+   Param::SetFloat(Param::tempty, TimePredictor::CalculateTimeToEmpty(soc, avgPower, Param::GetInt(Param::totalcells)));
+}
+
+static void RunCellStream(BmsFsm::bmsstate stt)
+{
+   float voltages[CELLSTREAM_MAX_CELLS];
+   int numCells = MIN(Param::GetInt(Param::numchan), CELLSTREAM_MAX_CELLS);
+
+   if (stt != BmsFsm::RUN && stt != BmsFsm::IDLE) return;
+
+   for (int i = 0; i < numCells; i++)
+      voltages[i] = Param::GetFloat((Param::PARAM_NUM)(Param::u0 + i));
+
+   uint32_t canId = bmsFsm->GetPdoBase() + CELLSTREAM_OFFSET + bmsFsm->GetIndex();
+   CellStream::Run(canMapInternal->GetHardware(), canId, bmsFsm->GetIndex(), voltages, numCells);
+}
+
+/** \brief Predicts the hottest cell core of the pack
+ * The hottest NTC of each module is the surface temperature of its model,
+ * the cells next to it are the ones to protect.
+ */
+static void RunThermalModel()
+{
+   float current = Param::GetFloat(Param::idc);
+   float coreTempMax = -40;
+
+   for (int i = 0; i < bmsFsm->GetNumberOfModules(); i++)
+   {
+      float surfaceTemp = bmsFsm->GetModuleData(i)->tempmax;
+
+      if (surfaceTemp < NO_TEMP)
+         coreTempMax = MAX(coreTempMax, thermalModels[i].Run(current, surfaceTemp));
+      else
+         thermalModels[i].Reset();
+   }
+
+   Param::SetFloat(Param::tcoremax, coreTempMax);
 }
 
 static void CalculateSocSoh(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
 {
-   static float estimatedSoc = 0, estimatedSocAtValidSoh = -1, asDiffAfterEstimate = 0, soh = 0;
+   static float soh = 0;
    float asDiff = Param::GetFloat(Param::chargein) - Param::GetFloat(Param::chargeout);
 
+   /* Without a journaled starting point integrate from the stored SoC. That
+      already contains all charge counted so far, so don't apply it again */
    if (estimatedSoc == 0)
    {
       estimatedSoc = Param::GetFloat(Param::soc);
-      estimatedSocAtValidSoh = estimatedSoc;
+      asDiffAfterEstimate = asDiff;
+      //Otherwise continue the SoH estimation that was interrupted by the reset
+      if (!estimatorRestored)
+         estimatedSocAtValidSoh = estimatedSoc;
    }
 
    /* if we change over from IDLE to RUN we have to stop all estimation processes
@@ -131,6 +353,233 @@ static void CalculateSocSoh(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
    }
 }
 
+static void RunCycleCounter(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
+{
+   CycleCounter::AddSoc(Param::GetFloat(Param::soc));
+   CycleCounter::AddCharge(Param::GetFloat(Param::chargein), Param::GetFloat(Param::chargeout));
+   Param::SetFloat(Param::efc, CycleCounter::GetEquivalentFullCycles(Param::GetFloat(Param::nomcap)));
+   Param::SetFloat(Param::ahthrough, CycleCounter::GetThroughput());
+
+   static bool unsaved = false, saved = false;
+   static uint32_t lastSave = 0;
+
+   if (stt == BmsFsm::IDLE && laststt == BmsFsm::RUN)
+      unsaved = true;
+
+   /* Persist after a drive or charge, but at most once per interval so frequent
+      RUN/IDLE changes don't wear out the page. The main loop does the flash write */
+   if (unsaved && stt == BmsFsm::IDLE && (!saved || (TimeBase::GetMillis() - lastSave) >= CYCLES_SAVE_INTERVAL))
+   {
+      EventLoop::Post(EventLoop::EV_SAVE_CYCLES);
+      lastSave = TimeBase::GetMillis();
+      unsaved = false;
+      saved = true;
+   }
+}
+
+/** \brief Feeds the lifetime statistics, cell voltages and temperature once per second
+ * Runs in the 100 ms task so the measurement tasks aren't slowed down
+ */
+static void RunLifetimeStats(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
+{
+   static uint8_t divider = 0;
+   static uint32_t secondsSinceSave = 0;
+
+   if (stt != BmsFsm::RUN && stt != BmsFsm::IDLE) return;
+
+   LifetimeStats::AddCurrent(Param::GetFloat(Param::idc));
+
+   if (++divider >= 10)
+   {
+      float voltages[LS_CELLS];
+      int numCells = MIN(Param::GetInt(Param::numchan), LS_CELLS);
+
+      for (int i = 0; i < numCells; i++)
+         voltages[i] = Param::GetFloat((Param::PARAM_NUM)(Param::u0 + i));
+
+      LifetimeStats::AddCells(voltages, numCells, 1);
+
+      if (Param::GetInt(Param::tempsns) != 0)
+         LifetimeStats::AddTemperature(Param::GetFloat(Param::tempmin0), Param::GetFloat(Param::tempmax0), 1);
+
+      divider = 0;
+      secondsSinceSave++;
+   }
+
+   //Also save after every drive, the module might be powered off when parked
+   if (secondsSinceSave >= STATS_SAVE_INTERVAL || (stt == BmsFsm::IDLE && laststt == BmsFsm::RUN))
+   {
+      EventLoop::Post(EventLoop::EV_SAVE_STATS);
+      secondsSinceSave = 0;
+   }
+}
+
+/** \brief Appends the changes to the flash log, starts a new page with a snapshot when full */
+static void SaveLifetimeStats()
+{
+   static uint32_t record[MAX(LS_DELTA_WORDS, LS_SNAPSHOT_WORDS)];
+   int words;
+
+   //Copy with the 100 ms task locked out, so no second is lost or counted twice
+   cm_disable_interrupts();
+   words = LifetimeStats::TakeDelta(record);
+   cm_enable_interrupts();
+
+   //Only the changed bins are listed, usually a small fraction of the page
+   if (words <= LS_EXTREME_WORDS || statsLog.Append(LifetimeStats::REC_DELTA, record, words))
+      return;
+
+   //The page is full. The totals already contain the delta we just took
+   cm_disable_interrupts();
+   words = LifetimeStats::GetStorageWords();
+   for (int i = 0; i < words; i++)
+      record[i] = LifetimeStats::GetStorage()[i];
+   LifetimeStats::ClearDelta();
+   cm_enable_interrupts();
+
+   statsLog.StartPage(LifetimeStats::REC_SNAPSHOT, record, words);
+}
+
+static void ReplayLifetimeStats(uint16_t type, const uint32_t* data, int words)
+{
+   if (type == LifetimeStats::REC_SNAPSHOT)
+      LifetimeStats::Load(data, words);
+   else if (type == LifetimeStats::REC_DELTA)
+      LifetimeStats::ApplyDelta(data, words);
+}
+
+static void GetJournalState(StateJournal::State& s)
+{
+   s.chargeIn = Param::GetFloat(Param::chargein);
+   s.chargeOut = Param::GetFloat(Param::chargeout);
+   s.energyIn = EnergyCounter::GetIn();
+   s.energyOut = EnergyCounter::GetOut();
+   s.estimatedSoc = estimatedSoc;
+   s.estimatedSocAtValidSoh = estimatedSocAtValidSoh;
+   s.asDiffAfterEstimate = asDiffAfterEstimate;
+}
+
+/** \brief Keeps the backup registers current and schedules flash journal records
+ *
+ * The backup registers are updated once per second. Flash is written every
+ * STATE_SAVE_INTERVAL while something changed and right away when the pack
+ * starts or stops moving current, as that is when the estimator state changes.
+ */
+static void RunStateJournal(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
+{
+   static uint8_t divider = 0;
+   static uint32_t secondsSinceSave = 0;
+   StateJournal::State state;
+   uint16_t regs[JOURNAL_BACKUP_WORDS];
+
+   if ((stt == BmsFsm::IDLE && laststt == BmsFsm::RUN) || (stt == BmsFsm::RUN && laststt == BmsFsm::IDLE))
+   {
+      EventLoop::Post(EventLoop::EV_SAVE_STATE);
+      secondsSinceSave = 0;
+   }
+
+   if (++divider < 10) return;
+
+   divider = 0;
+   secondsSinceSave++;
+   GetJournalState(state);
+
+   if (secondsSinceSave >= STATE_SAVE_INTERVAL)
+   {
+      if (memcmp(&state, &savedState, sizeof(state)) != 0)
+         EventLoop::Post(EventLoop::EV_SAVE_STATE);
+      secondsSinceSave = 0;
+   }
+
+   StateJournal::EncodeBackup(state, savedState, stateSequence, regs);
+
+   for (int i = 0; i < JOURNAL_BACKUP_WORDS; i++)
+      *journalRegs[i] = regs[i];
+}
+
+/** \brief Writes a state journal record, starts a new page when full */
+static void SaveStateJournal()
+{
+   static uint32_t record[JOURNAL_RECORD_WORDS];
+   StateJournal::State state;
+   uint16_t sequence = stateSequence + 1;
+
+   cm_disable_interrupts();
+   GetJournalState(state);
+   cm_enable_interrupts();
+
+   StateJournal::EncodeRecord(state, sequence, record);
+
+   if (!stateLog.Append(StateJournal::REC_STATE, record, JOURNAL_RECORD_WORDS))
+      stateLog.StartPage(StateJournal::REC_STATE, record, JOURNAL_RECORD_WORDS);
+
+   //From now on the backup registers count from this record
+   cm_disable_interrupts();
+   savedState = state;
+   stateSequence = sequence;
+   cm_enable_interrupts();
+}
+
+static void ReplayStateJournal(uint16_t type, const uint32_t* data, int words)
+{
+   uint16_t sequence;
+
+   //The last valid record wins
+   if (type == StateJournal::REC_STATE && StateJournal::DecodeRecord(data, words, savedState, sequence))
+      stateSequence = sequence;
+}
+
+/** \brief Restores the state from the flash journal plus the charge counted since in the backup registers
+ * Without any flash record the backup registers still count from zero.
+ */
+static void LoadStateJournal()
+{
+   uint16_t regs[JOURNAL_BACKUP_WORDS];
+
+   savedState.estimatedSocAtValidSoh = -1;
+   stateLog.Open(ReplayStateJournal);
+
+   StateJournal::State state = savedState;
+
+   for (int i = 0; i < JOURNAL_BACKUP_WORDS; i++)
+      regs[i] = *journalRegs[i];
+
+   StateJournal::DecodeBackup(regs, stateSequence, state);
+
+   Param::SetFloat(Param::chargein, state.chargeIn);
+   Param::SetFloat(Param::chargeout, state.chargeOut);
+   EnergyCounter::SetTotals(state.energyIn, state.energyOut);
+   Param::SetFloat(Param::energyin, EnergyCounter::GetIn());
+   Param::SetFloat(Param::energyout, EnergyCounter::GetOut());
+   estimatedSoc = state.estimatedSoc;
+   estimatedSocAtValidSoh = state.estimatedSocAtValidSoh;
+   asDiffAfterEstimate = state.asDiffAfterEstimate;
+   estimatorRestored = estimatedSocAtValidSoh >= 0;
+}
+
+static void RunSelfDischargeAnalysis(BmsFsm::bmsstate stt)
+{
+   uint32_t now = rtc_get_counter_val();
+
+   if (SelfDischarge::Run(now, stt == BmsFsm::IDLE))
+   {
+      float voltages[SD_MAX_CELLS];
+      int numCells = Param::GetInt(Param::numchan);
+
+      for (int i = 0; i < numCells; i++)
+         voltages[i] = Param::GetFloat((Param::PARAM_NUM)(Param::u0 + i));
+
+      SelfDischarge::AddSample(now, voltages, numCells);
+   }
+
+   if (SelfDischarge::IsValid())
+   {
+      int worstCell = SelfDischarge::GetWorstCell();
+      Param::SetInt(Param::sdcell, worstCell);
+      Param::SetFloat(Param::sdleakmax, SelfDischarge::GetLeakageCurrent(worstCell));
+   }
+}
+
 static void Ms100Task(void)
 {
    static uint8_t ledDivider = 0;
@@ -139,6 +588,8 @@ static void Ms100Task(void)
    iwdg_reset();
    float cpuLoad = scheduler->GetCpuLoad();
    Param::SetFloat(Param::cpuload, cpuLoad / 10);
+   MeasureCpuDuty();
+   PublishTaskProfile();
 
    if (Param::GetInt(Param::opmode) != BmsFsm::ERROR)
       DigIo::led_out.Toggle();
@@ -155,30 +606,57 @@ static void Ms100Task(void)
 
    BmsFsm::bmsstate laststt = (BmsFsm::bmsstate)Param::GetInt(Param::opmode);
    BmsFsm::bmsstate stt = bmsFsm->Run(laststt);
+
+   if (stt != laststt)
+   {
+      Trace::Add(Trace::TR_STATE, stt, laststt);
+      Capture::Trigger(Capture::TRIG_STATE);
+   }
+
    BmsIO::ReadTemperatures();
+   RunIsaCan();
+   RunSelfDischargeAnalysis(stt);
 
    if (bmsFsm->IsFirst())
    {
-      CalculateCurrentLimits();
+      if (stt == BmsFsm::RUN || stt == BmsFsm::IDLE)
+      {
+         CheckModuleFreshness();
+         RunLivenessMonitor();
+      }
+      RunThermalModel();
+      float chargeDerating = CalculateCurrentLimits();
       CalculateSocSoh(stt, laststt);
+      RunTimePrediction(chargeDerating);
+      RunCycleCounter(stt, laststt);
    }
 
+   RunLifetimeStats(stt, laststt);
+   RunStateJournal(stt, laststt);
+
    Param::SetInt(Param::opmode, stt);
+   UpdateLowPower(stt);
    //4 bit circular counter for alive indication
    Param::SetInt(Param::counter, (Param::GetInt(Param::counter) + 1) & 0xF);
    Param::SetInt(Param::uptime, rtc_get_counter_val());
 
    canSdo->TriggerTimeout(100);
-   canMapExternal->SendAll();
-   canMapInternal->SendAll();
+
+   if (Param::GetInt(Param::canperiod) == CAN_PERIOD_100MS)
+      canMapExternal->SendAll();
+   RunCellStream(stt);
 }
 
 static void RunSelfTest()
 {
    static int test = 0;
    if (SelfTest::GetLastResult() == SelfTest::TestFailed) return; //do not call anymore tests
+   int step = test;
    SelfTest::TestResult result = SelfTest::RunTest(test);
 
+   if (result != SelfTest::TestOngoing)
+      Trace::Add(Trace::TR_SELFTEST, (step << 2) | result, SelfTest::GetErrorChannel());
+
    if (result == SelfTest::TestFailed)
    {
       ErrorMessage::Post((ERROR_MESSAGE_NUM)(test + 1));
@@ -187,12 +665,72 @@ static void RunSelfTest()
    }
 }
 
+static void RunCurrentFrame()
+{
+   int opmode = Param::GetInt(Param::opmode);
+   uint32_t data[2];
+
+   //Only the master sends, two senders of the same id would corrupt each other's frames
+   if (!bmsFsm->IsMain() || Param::GetInt(Param::idcmode) == IDC_OFF) return;
+   if (opmode != BmsFsm::RUN && opmode != BmsFsm::IDLE) return;
+
+   if (CurrentFrame::Run(Param::GetFloat(Param::idc), TimeBase::GetMillis(), data))
+      canMapInternal->GetHardware()->Send(bmsFsm->GetPdoBase() + CURRENTFRAME_OFFSET, data);
+}
+
+/** \brief Current measurement and the internal PDOs, runs every 5 ms */
+static void Ms5Task(void)
+{
+   static bool second = false;
+   static uint8_t currentDivider = 0;
+
+   TimeBase::Tick(5);
+
+   //A capture records every sample, so it runs at full rate even in low power
+   if (!lowPower || Capture::IsActive())
+   {
+      //Includes the time since the last sample at reduced rate
+      BmsIO::MeasureCurrent((currentDivider + 1) * 0.005f);
+      currentDivider = 0;
+   }
+   else if (++currentDivider >= IDLE_CURRENT_DIVIDER)
+   {
+      currentDivider = 0;
+      BmsIO::MeasureCurrent(IDLE_CURRENT_DIVIDER * 0.005f);
+
+      //Return to full rate right away, the FSM leaves IDLE only after a full idcavg period
+      if (ABS(Param::GetFloat(Param::idc)) > Param::GetFloat(Param::idlethresh))
+         lowPower = false;
+   }
+
+   //The frame rate is based on 5 ms calls, in low power the last sample is repeated
+   RunCurrentFrame();
+
+   second = !second;
+   if (!second) return; //Messages go out every 10 ms
+
+   PdoScheduler::Run(canMapInternal->GetHardware());
+
+   if (Param::GetInt(Param::canperiod) == CAN_PERIOD_10MS)
+      canMapExternal->SendAll();
+}
+
 /** \brief This task runs the BMS voltage sensing */
 static void ReadCellVoltages(void)
 {
+   static uint8_t cellDivider = 0;
    int opmode = Param::GetInt(Param::opmode);
    int testchan = Param::GetInt(Param::testchan);
 
+   if (lowPower && ++cellDivider < IDLE_CELL_DIVIDER) return;
+   cellDivider = 0;
+
+   //Check both tasks, the flags are cleared on reading
+   bool violated = TaskProfiler::CheckViolation(PROF_MUX);
+   violated |= TaskProfiler::CheckViolation(PROF_CELLS);
+
+   BmsIO::SetTimingViolated(violated && Param::GetInt(Param::timingpol) == TIMING_DISCARD);
+
    if (opmode == BmsFsm::SELFTEST)
       RunSelfTest();
    else if (testchan >= 0)
@@ -203,44 +741,178 @@ static void ReadCellVoltages(void)
       FlyingAdcBms::MuxOff();
 }
 
+/** \brief Configures the charge profile stages from icc1..5, ucv1..4 and tcc1..5
+ * A stage with 0 current ends the profile, the last used stage aims for ucellmax
+ */
+static void ConfigureChargeProfile()
+{
+   const Param::PARAM_NUM currents[] = { Param::icc1, Param::icc2, Param::icc3, Param::icc4, Param::icc5 };
+   const Param::PARAM_NUM voltages[] = { Param::ucv1, Param::ucv2, Param::ucv3, Param::ucv4 };
+   const Param::PARAM_NUM temps[] = { Param::tcc1, Param::tcc2, Param::tcc3, Param::tcc4, Param::tcc5 };
+   int numStages = 1;
+
+   while (numStages < MAX_CHARGE_STAGES && Param::GetFloat(currents[numStages]) > 0)
+      numStages++;
+
+   for (int i = 0; i < numStages; i++)
+   {
+      int voltage = i == (numStages - 1) ? Param::GetInt(Param::ucellmax) : Param::GetInt(voltages[i]);
+      BmsAlgo::SetChargeStage(i, Param::GetFloat(currents[i]), voltage, Param::GetFloat(temps[i]));
+   }
+   BmsAlgo::SetNumChargeStages(numStages);
+   TimePredictor::Invalidate();
+}
+
+static void Reboot() { Param::SetInt(Param::opmode, BmsFsm::REBOOT); }
+static void PresetSoh() { Param::SetFloat(Param::soh, Param::GetFloat(Param::sohpreset)); }
+static void ConfigureMinVoltage() { BmsAlgo::SetMinVoltage(Param::GetInt(Param::ucellmin), Param::GetFloat(Param::dischargemax)); }
+static void ConfigureCellFps() { CellStream::SetFrameRate(Param::GetFloat(Param::cellfps)); }
+static void ConfigureIdcRate() { CurrentFrame::SetFrameRate(Param::GetFloat(Param::idcrate)); }
+static void ConfigureIsaPeriod() { isaCan->SetCyclePeriod(Param::GetInt(Param::isaperiod)); }
+static void ConfigureSocTarget() { TimePredictor::SetTarget(Param::GetFloat(Param::soctarget)); }
+static void ConfigureCutoff() { TimePredictor::SetCutoffCurrent(Param::GetFloat(Param::icutoff)); }
+static void ConfigureSelfTest() { SelfTest::SetNumChannels(Param::GetInt(Param::numchan)); }
+
+static void ConfigureCapacity()
+{
+   BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap));
+   SelfDischarge::SetNominalCapacity(Param::GetFloat(Param::nomcap));
+   TimePredictor::SetCapacity(Param::GetFloat(Param::nomcap));
+}
+
+static void ConfigureController()
+{
+   BmsAlgo::SetControllerGains(Param::GetFloat(Param::ucellkp), Param::GetFloat(Param::ucellki));
+}
+
+static void ConfigureCellModel()
+{
+   ThermalModel::SetCellParameters(Param::GetFloat(Param::rcell) / 1000.0f, Param::GetFloat(Param::cthcell), Param::GetFloat(Param::rthcell));
+   TimePredictor::SetCellResistance(Param::GetFloat(Param::rcell));
+}
+
+static void ConfigureSocTable()
+{
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, Param::GetInt((Param::PARAM_NUM)(Param::ucell0soc + i)));
+}
+
+//Handlers that derive data from parameters. The last column marks the ones that also run on start up
+#define CHANGE_HANDLER_LIST \
+   CHANGE_HANDLER(CHG_REBOOT,      Reboot,                 false) \
+   CHANGE_HANDLER(CHG_SOH,         PresetSoh,              false) \
+   CHANGE_HANDLER(CHG_CHARGE,      ConfigureChargeProfile, true ) \
+   CHANGE_HANDLER(CHG_MINVOLTAGE,  ConfigureMinVoltage,    true ) \
+   CHANGE_HANDLER(CHG_CAPACITY,    ConfigureCapacity,      true ) \
+   CHANGE_HANDLER(CHG_CONTROLLER,  ConfigureController,    true ) \
+   CHANGE_HANDLER(CHG_CELLMODEL,   ConfigureCellModel,     true ) \
+   CHANGE_HANDLER(CHG_CELLFPS,     ConfigureCellFps,       true ) \
+   CHANGE_HANDLER(CHG_IDCRATE,     ConfigureIdcRate,       true ) \
+   CHANGE_HANDLER(CHG_ISAPERIOD,   ConfigureIsaPeriod,     true ) \
+   CHANGE_HANDLER(CHG_SOCTARGET,   ConfigureSocTarget,     true ) \
+   CHANGE_HANDLER(CHG_CUTOFF,      ConfigureCutoff,        true ) \
+   CHANGE_HANDLER(CHG_SOCTABLE,    ConfigureSocTable,      true ) \
+   CHANGE_HANDLER(CHG_BMSIO,       BmsIO::UpdateConfig,    true ) \
+   CHANGE_HANDLER(CHG_SELFTEST,    ConfigureSelfTest,      true )
+
+#define CHANGE_HANDLER(id, func, init) id,
+enum ChangeHandler { CHANGE_HANDLER_LIST CHG_LAST };
+#undef CHANGE_HANDLER
+static_assert(CHG_LAST <= 32, "Handler mask is 32 bit wide");
+
+#define CHANGE_HANDLER(id, func, init) func,
+static void (* const changeHandlers[CHG_LAST])() = { CHANGE_HANDLER_LIST };
+#undef CHANGE_HANDLER
+
+#define CHANGE_HANDLER(id, func, init) | (init ? (1u << id) : 0)
+static const uint32_t initHandlers = 0 CHANGE_HANDLER_LIST;
+#undef CHANGE_HANDLER
+
+#define H(id) (1u << id)
+
+//Handlers to run when a parameter changes, parameters not listed need none
+#define PARAM_DEPENDENCY_LIST \
+   PARAM_DEPENDS(reboot,       H(CHG_REBOOT)) \
+   PARAM_DEPENDS(sohpreset,    H(CHG_SOH)) \
+   PARAM_DEPENDS(icc1,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(icc2,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(icc3,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(icc4,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(icc5,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucv1,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucv2,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucv3,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucv4,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucellmax,     H(CHG_CHARGE)) \
+   PARAM_DEPENDS(tcc1,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(tcc2,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(tcc3,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(tcc4,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(tcc5,         H(CHG_CHARGE)) \
+   PARAM_DEPENDS(ucellmin,     H(CHG_MINVOLTAGE)) \
+   PARAM_DEPENDS(dischargemax, H(CHG_MINVOLTAGE)) \
+   PARAM_DEPENDS(nomcap,       H(CHG_CAPACITY)) \
+   PARAM_DEPENDS(ucellkp,      H(CHG_CONTROLLER)) \
+   PARAM_DEPENDS(ucellki,      H(CHG_CONTROLLER)) \
+   PARAM_DEPENDS(rcell,        H(CHG_CELLMODEL)) \
+   PARAM_DEPENDS(cthcell,      H(CHG_CELLMODEL)) \
+   PARAM_DEPENDS(rthcell,      H(CHG_CELLMODEL)) \
+   PARAM_DEPENDS(cellfps,      H(CHG_CELLFPS)) \
+   PARAM_DEPENDS(idcrate,      H(CHG_IDCRATE)) \
+   PARAM_DEPENDS(isaperiod,    H(CHG_ISAPERIOD)) \
+   PARAM_DEPENDS(soctarget,    H(CHG_SOCTARGET)) \
+   PARAM_DEPENDS(icutoff,      H(CHG_CUTOFF)) \
+   PARAM_DEPENDS(ucell0soc,    H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell10soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell20soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell30soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell40soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell50soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell60soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell70soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell80soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell90soc,   H(CHG_SOCTABLE)) \
+   PARAM_DEPENDS(ucell100soc,  H(CHG_SOCTABLE) | H(CHG_BMSIO)) \
+   PARAM_DEPENDS(gain,         H(CHG_BMSIO)) \
+   PARAM_DEPENDS(correction0,  H(CHG_BMSIO)) \
+   PARAM_DEPENDS(correction1,  H(CHG_BMSIO)) \
+   PARAM_DEPENDS(correction15, H(CHG_BMSIO)) \
+   PARAM_DEPENDS(numchan,      H(CHG_BMSIO) | H(CHG_SELFTEST)) \
+   PARAM_DEPENDS(balmode,      H(CHG_BMSIO)) \
+   PARAM_DEPENDS(ubalance,     H(CHG_BMSIO)) \
+   PARAM_DEPENDS(ibalance,     H(CHG_BMSIO)) \
+   PARAM_DEPENDS(idcmode,      H(CHG_BMSIO)) \
+   PARAM_DEPENDS(idcgain,      H(CHG_BMSIO)) \
+   PARAM_DEPENDS(idcofs,       H(CHG_BMSIO)) \
+   PARAM_DEPENDS(idlethresh,   H(CHG_BMSIO)) \
+   PARAM_DEPENDS(tempsns,      H(CHG_BMSIO)) \
+   PARAM_DEPENDS(tempres,      H(CHG_BMSIO)) \
+   PARAM_DEPENDS(tempbeta,     H(CHG_BMSIO))
+
+static void RunChangeHandlers(uint32_t handlers)
+{
+   for (int i = 0; i < CHG_LAST; i++)
+   {
+      if (handlers & H(i))
+         changeHandlers[i]();
+   }
+}
+
 /** This function is called when the user changes a parameter */
 void Param::Change(Param::PARAM_NUM paramNum)
 {
+   uint32_t handlers = 0;
+
    switch (paramNum)
    {
-   case Param::reboot:
-      Param::SetInt(Param::opmode, BmsFsm::REBOOT);
-      break;
-   case Param::sohpreset:
-      Param::SetFloat(Param::soh, Param::GetFloat(Param::sohpreset));
-      break;
-   case Param::icc1:
-   case Param::ucv1:
-      BmsAlgo::SetCCCVCurve(0, Param::GetFloat(Param::icc1), Param::GetInt(Param::ucv1));
-      break;
-   case Param::icc2:
-   case Param::ucv2:
-      BmsAlgo::SetCCCVCurve(1, Param::GetFloat(Param::icc2), Param::GetInt(Param::ucv2));
-      break;
-   case Param::icc3:
-   case Param::ucellmax:
-      BmsAlgo::SetCCCVCurve(2, Param::GetFloat(Param::icc3), Param::GetInt(Param::ucellmax));
-      break;
-   case Param::nomcap:
-      BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap));
-      break;
-   case Param::ucellkp:
-   case Param::ucellki:
-      BmsAlgo::SetControllerGains(Param::GetFloat(Param::ucellkp), Param::GetFloat(Param::ucellki));
-      break;
-   case Param::ucellmin:
-      BmsAlgo::SetMinVoltage(Param::GetInt(Param::ucellmin), Param::GetFloat(Param::dischargemax));
-      break;
+#define PARAM_DEPENDS(param, h) case Param::param: handlers = h; break;
+   PARAM_DEPENDENCY_LIST
+#undef PARAM_DEPENDS
    default:
-      for (int i = 0; i < 11; i++)
-         BmsAlgo::SetSocLookupPoint(i * 10, Param::GetInt((Param::PARAM_NUM)(Param::ucell0soc + i)));
       break;
    }
+
+   RunChangeHandlers(handlers);
 }
 
 static void LoadNVRAM()
@@ -258,15 +930,8 @@ static void LoadNVRAM()
 
 static void InitParameters()
 {
-   BmsAlgo::SetCCCVCurve(0, Param::GetFloat(Param::icc1), Param::GetInt(Param::ucv1));
-   BmsAlgo::SetCCCVCurve(1, Param::GetFloat(Param::icc2), Param::GetInt(Param::ucv2));
-   BmsAlgo::SetCCCVCurve(2, Param::GetFloat(Param::icc3), Param::GetInt(Param::ucellmax));
-   BmsAlgo::SetMinVoltage(Param::GetInt(Param::ucellmin), Param::GetFloat(Param::dischargemax));
-   BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap));
-   BmsAlgo::SetControllerGains(Param::GetFloat(Param::ucellkp), Param::GetFloat(Param::ucellki));
-   SelfTest::SetNumChannels(Param::GetInt(Param::numchan));
-   for (int i = 0; i < 11; i++)
-      BmsAlgo::SetSocLookupPoint(i * 10, Param::GetInt((Param::PARAM_NUM)(Param::ucell0soc + i)));
+   RunChangeHandlers(initHandlers);
+   ThermalModel::SetCallingFrequency(10);
    Param::SetInt(Param::hwrev, hwRev);
    Param::SetInt(Param::version, 4);
 }
@@ -278,6 +943,65 @@ extern "C" void tim2_isr(void)
    scheduler->Run();
 }
 
+/** \brief Replies to a pending userspace SDO and starts requested JSON dumps
+ * The latency from reception to reply is tracked separately while a dump is running
+ */
+static void ServiceSdo(CanSdo* sdo)
+{
+   CanSdo::SdoFrame* sdoFrame = sdo->GetPendingUserspaceSdo();
+
+   if (!JsonPrinter::IsBusy() && sdo->GetPrintRequest() == PRINT_JSON)
+      JsonPrinter::Start(sdo, false);
+
+   if (0 != sdoFrame)
+   {
+      if (!BmsSdo::ProcessCommand(sdoFrame))
+         SdoCommands::ProcessStandardCommands(sdoFrame);
+      sdo->SendSdoReply(sdoFrame);
+
+      uint32_t latency = TimeBase::CyclesToMicros(TimeBase::GetCycles() - EventLoop::GetPostTime(EventLoop::EV_SDO));
+      Param::SetInt(Param::sdolat, latency);
+      Param::SetInt(Param::sdolatmax, MAX((uint32_t)Param::GetInt(Param::sdolatmax), latency));
+
+      if (JsonPrinter::IsBusy())
+         Param::SetInt(Param::sdolatjson, MAX((uint32_t)Param::GetInt(Param::sdolatjson), latency));
+   }
+}
+
+/** \brief Runs one pending flash write at a time
+ * Erasing a page stalls the CPU including the scheduler for up to 40 ms. After
+ * a drive all logs are due at once, so spread them out to have the tasks
+ * miss at most one deadline in a row.
+ */
+static void RunFlashWrites(uint32_t events)
+{
+   const uint32_t flashEvents = (1 << EventLoop::EV_SAVE_CYCLES) | (1 << EventLoop::EV_SAVE_STATS) | (1 << EventLoop::EV_SAVE_STATE);
+   static uint32_t pending = 0, lastWrite = 0;
+   uint32_t now = TimeBase::GetMillis();
+
+   pending |= events & flashEvents;
+
+   if (pending == 0 || (now - lastWrite) < FLASH_WRITE_GAP) return;
+
+   if (EventLoop::IsSet(pending, EventLoop::EV_SAVE_CYCLES))
+   {
+      FlashStore::Save(CYCLES_BLKNUM, CycleCounter::GetStorage(), CycleCounter::GetStorageWords());
+      pending &= ~(1 << EventLoop::EV_SAVE_CYCLES);
+   }
+   else if (EventLoop::IsSet(pending, EventLoop::EV_SAVE_STATS))
+   {
+      SaveLifetimeStats();
+      pending &= ~(1 << EventLoop::EV_SAVE_STATS);
+   }
+   else
+   {
+      SaveStateJournal();
+      pending &= ~(1 << EventLoop::EV_SAVE_STATE);
+   }
+
+   lastWrite = now;
+}
+
 extern "C" int main(void)
 {
    clock_setup(); //Must always come first
@@ -296,6 +1020,7 @@ extern "C" int main(void)
    gpio_primary_remap(AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_ON, 0);
 
    nvic_setup(); //Set up some interrupts
+   TimeBase::Init();
    parm_load(); //Load stored parameters
 
    Stm32Scheduler s(TIM2); //We never exit main so it's ok to put it on stack
@@ -311,34 +1036,55 @@ extern "C" int main(void)
 
    BmsFsm fsm(&cmi, &sdo);
    bmsFsm = &fsm;
+   IsaCan isa(&c);
+   isa.SetCurrentHandler(BmsIO::HandleIsaCurrent);
+   isaCan = &isa;
    BmsIO::SetBmsFsm(&fsm);
+   BmsSdo::SetBmsFsm(&fsm);
+
+   //Must come after CanSdo so the request is stored when the event is posted
+   SdoEventSource sdoEvents(&c);
 
    TerminalCommands::SetCanMap(canMapExternal);
    SdoCommands::SetCanMap(canMapExternal);
+   JsonPrinter::SetCanMap(canMapExternal);
 
-   s.AddTask(BmsIO::MeasureCurrent, 5);
-   s.AddTask(ReadCellVoltages, 25);
-   s.AddTask(BmsIO::SwitchMux, 2); //This must be added after ReadCellVoltages() to avoid an additional 2 ms delay
-   s.AddTask(Ms100Task, 100);
-
+   //The tasks read configuration derived from the parameters right away
    InitParameters();
 
+   //The estimator state must be restored before Ms100Task first runs CalculateSocSoh()
    LoadNVRAM();
+   LoadStateJournal();
+
+   s.AddTask(TaskProfiler::Run<Ms5Task, PROF_MS5>, 5);
+   s.AddTask(TaskProfiler::Run<ReadCellVoltages, PROF_CELLS>, 25);
+   //This must be added after ReadCellVoltages() to avoid an additional 2 ms delay
+   s.AddTask(TaskProfiler::Run<BmsIO::SwitchMux, PROF_MUX>, 2);
+   s.AddTask(TaskProfiler::Run<Ms100Task, PROF_MS100>, 100);
+   //Mux dead times are only 2 ms, the other tasks are less sensitive
+   TaskProfiler::SetDeadline(PROF_MS5, 5, 1000);
+   TaskProfiler::SetDeadline(PROF_CELLS, 25, 1000);
+   TaskProfiler::SetDeadline(PROF_MUX, 2, 300);
+   TaskProfiler::SetDeadline(PROF_MS100, 100, 10000);
+
+   if (!FlashStore::Load(CYCLES_BLKNUM, CycleCounter::GetStorage(), CycleCounter::GetStorageWords()))
+      CycleCounter::Reset();
+
+   LifetimeStats::Reset();
+   statsLog.Open(ReplayLifetimeStats);
 
    while(1)
    {
-      char c = 0;
-      CanSdo::SdoFrame* sdoFrame = sdo.GetPendingUserspaceSdo();
+      uint32_t events = EventLoop::Take();
 
-      if (sdo.GetPrintRequest() == PRINT_JSON)
-      {
-         TerminalCommands::PrintParamsJson(&sdo, &c);
-      }
-      if (0 != sdoFrame)
-      {
-         SdoCommands::ProcessStandardCommands(sdoFrame);
-         sdo.SendSdoReply(sdoFrame);
-      }
+      if (EventLoop::IsSet(events, EventLoop::EV_SDO))
+         ServiceSdo(&sdo);
+
+      RunFlashWrites(events);
+
+      //One parameter per pass so SDO requests are answered in between
+      if (!JsonPrinter::Run())
+         EventLoop::WaitForEvent();
    }
 
    return 0;
@@ -0,0 +1,313 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "moduledisc.h"
+
+#define FORWARD_TIMEOUT  10 //Stop repeating the token when nobody took it after 1s, we are the last module
+#define CHAIN_QUIET      (FORWARD_TIMEOUT + 2) //Chain is complete when no new module showed up for this long
+#define INFO_WINDOW      3  //Cycles to wait for info responses
+#define INFO_RETRIES     3
+#define TOKEN_LISTEN     2  //Cycles to listen for the highest token index
+#define HELLO_DELAY      3  //Send hello when no token arrived after this many cycles
+#define HELLO_INTERVAL   3  //Then repeat it at this interval until admitted
+#define ADMIT_REPEAT     3  //Send the token of an admitted module this often
+
+ModuleDiscovery::ModuleDiscovery()
+   : state(DONE), isMaster(false), infoRequested(false), tokenSeen(false), helloPending(false), nodeId(0), index(0),
+     pdobase(0), cycles(0), retries(0), highestIndex(0), lastIndex(DISC_NO_INDEX), helloCells(0), admitIndex(0),
+     admitRepeat(0), numModules(1), received(0)
+{
+   for (int i = 0; i < MAX_MODULES; i++)
+      numChan[i] = 0;
+}
+
+/** \brief Starts enumeration on the first module of the chain
+ *
+ * \param id our SDO node id, sub modules get consecutive ids
+ * \param base PDO base id of the chain
+ * \param cells number of cells of this module
+ *
+ */
+void ModuleDiscovery::StartAsMaster(uint8_t id, uint16_t base, uint8_t cells)
+{
+   isMaster = true;
+   nodeId = id;
+   pdobase = base;
+   index = 0;
+   numChan[0] = cells;
+   numModules = 1;
+   highestIndex = 1;
+   received = 1;
+   retries = 0;
+   cycles = 0;
+   helloPending = false;
+   admitRepeat = 0;
+   state = FORWARD_TOKEN;
+}
+
+/** \brief Starts waiting for the address token on a sub module
+ * \param cells number of cells of this module
+ * \param prevIndex index this module had before a restart, DISC_NO_INDEX if unknown
+ */
+void ModuleDiscovery::StartAsSub(uint8_t cells, uint8_t prevIndex)
+{
+   isMaster = false;
+   lastIndex = prevIndex;
+   infoRequested = false;
+   tokenSeen = false;
+   nodeId = 0;
+   index = 0;
+   numChan[0] = cells;
+   cycles = 0;
+   state = WAIT_TOKEN;
+}
+
+/** \brief Advances the protocol, call once per cycle
+ *
+ * \param[out] canId id of the frame to send
+ * \param[out] data payload of the frame to send
+ * \return true if a frame must be sent
+ *
+ */
+bool ModuleDiscovery::Run(uint32_t& canId, uint32_t data[2])
+{
+   if (infoRequested)
+   {
+      //Answering the master takes priority, we repeat the token next cycle anyway
+      infoRequested = false;
+      canId = DISC_ID_INFO_RESP + index;
+      data[0] = numChan[0];
+      data[1] = nodeId;
+      return true;
+   }
+
+   if (admitRepeat > 0)
+   {
+      //Token on behalf of the predecessor of a restarted module
+      admitRepeat--;
+      canId = DISC_ID_TOKEN;
+      MakeToken(data, admitIndex - 1);
+      return true;
+   }
+
+   switch (state)
+   {
+   case WAIT_TOKEN:
+      cycles++;
+
+      if (tokenSeen)
+      {
+         if (cycles >= TOKEN_LISTEN)
+         {
+            cycles = 0;
+            state = FORWARD_TOKEN;
+         }
+      }
+      else if (cycles >= HELLO_DELAY)
+      {
+         //Nobody is enumerating, we were restarted in a running chain
+         cycles = HELLO_DELAY - HELLO_INTERVAL;
+         canId = DISC_ID_HELLO;
+         data[0] = numChan[0];
+         data[1] = lastIndex;
+         return true;
+      }
+      break;
+   case FORWARD_TOKEN:
+      if (++cycles > FORWARD_TIMEOUT)
+      {
+         //Nobody took the token, we are the last module. On the master this means there are no sub modules
+         cycles = 0;
+         state = DONE;
+         return false;
+      }
+      canId = DISC_ID_TOKEN;
+      MakeToken(data, index);
+      return true;
+   case WAIT_CHAIN:
+      if (++cycles >= CHAIN_QUIET)
+      {
+         cycles = 0;
+         state = COLLECT_INFO;
+         canId = DISC_ID_INFO_REQ;
+         data[0] = data[1] = 0;
+         return true;
+      }
+      break;
+   case COLLECT_INFO:
+      if (++cycles >= INFO_WINDOW)
+      {
+         bool complete = true;
+         numModules = 1;
+
+         for (int i = 1; i < highestIndex && i < MAX_MODULES; i++)
+         {
+            if (received & (1 << i))
+               numModules++;
+            else
+            {
+               complete = false;
+               break;
+            }
+         }
+
+         cycles = 0;
+
+         if (complete || ++retries > INFO_RETRIES)
+         {
+            state = DONE;
+         }
+         else
+         {
+            canId = DISC_ID_INFO_REQ;
+            data[0] = data[1] = 0;
+            return true;
+         }
+      }
+      break;
+   default:
+      break;
+   }
+   return false;
+}
+
+/** \brief Processes a received discovery frame */
+void ModuleDiscovery::HandleFrame(uint32_t canId, const uint32_t data[2])
+{
+   if (canId == DISC_ID_TOKEN)
+   {
+      uint8_t tokenIndex = (data[1] >> 8) & 0xFF;
+
+      if (state == WAIT_TOKEN && tokenIndex > index)
+      {
+         if (!tokenSeen) cycles = 0;
+         nodeId = data[1] & 0xFF;
+         index = tokenIndex;
+         pdobase = data[1] >> 16;
+         tokenSeen = true;
+      }
+      else if (state == FORWARD_TOKEN && tokenIndex == (index + 2))
+      {
+         //Next module forwards the token, so it has it
+         cycles = 0;
+         state = isMaster ? WAIT_CHAIN : DONE;
+      }
+
+      if (isMaster && tokenIndex > highestIndex)
+      {
+         //Another module joined, restart waiting for the chain to settle
+         highestIndex = tokenIndex;
+         if (state == WAIT_CHAIN) cycles = 0;
+      }
+   }
+   else if (canId == DISC_ID_HELLO)
+   {
+      //Only a complete chain admits modules, during enumeration they get their token anyway
+      if (isMaster && state == DONE)
+      {
+         helloPending = true;
+         helloCells = data[0];
+         lastIndex = data[1];
+      }
+   }
+   else if (canId == DISC_ID_INFO_REQ)
+   {
+      infoRequested = !isMaster && state != WAIT_TOKEN;
+   }
+   else if (isMaster && canId >= DISC_ID_INFO_RESP && canId < (DISC_ID_INFO_RESP + MAX_MODULES))
+   {
+      uint8_t mod = canId - DISC_ID_INFO_RESP;
+
+      numChan[mod] = data[0];
+      received |= 1 << mod;
+   }
+}
+
+/** \brief Returns the pending hello of a restarted module on the master
+ *
+ * \param[out] cells number of cells of that module
+ * \param[out] prevIndex index it had before, DISC_NO_INDEX if unknown
+ * \return true if a module is waiting to be admitted
+ *
+ */
+bool ModuleDiscovery::GetHello(uint8_t& cells, uint8_t& prevIndex)
+{
+   cells = helloCells;
+   prevIndex = lastIndex;
+   return helloPending;
+}
+
+/** \brief Admits the module of the pending hello at the given index
+ * \param mod index of the module, may be one past the current chain
+ */
+void ModuleDiscovery::Admit(uint8_t mod)
+{
+   if (mod == 0 || mod >= MAX_MODULES) return;
+
+   helloPending = false;
+   admitIndex = mod;
+   admitRepeat = ADMIT_REPEAT;
+   numChan[mod] = helloCells;
+   received |= 1 << mod;
+
+   if (mod >= numModules)
+      numModules = mod + 1;
+}
+
+/** \brief Picks the index for the module of a pending hello
+ *
+ * The remembered index is only trusted if that module is actually missing,
+ * a stale index must not take over the slot of a live module. Otherwise the
+ * first missing module is replaced. If none is missing the module is added
+ * to the end of the chain, but only once appendDue says no module went
+ * missing in time.
+ *
+ * \param prevIndex index the module reported in its hello
+ * \param lostMask bit field of modules that stopped sending
+ * \param modules current number of modules
+ * \param appendDue true when the module may be added at the end
+ * \return index to admit at, 0 to keep waiting
+ *
+ */
+uint8_t ModuleDiscovery::ChooseRestartIndex(uint8_t prevIndex, uint32_t lostMask, uint8_t modules, bool appendDue)
+{
+   if (prevIndex > 0 && prevIndex < modules && (lostMask & (1 << prevIndex)))
+      return prevIndex;
+
+   for (uint8_t mod = 1; mod < modules; mod++)
+   {
+      if (lostMask & (1 << mod))
+         return mod;
+   }
+
+   if (appendDue && modules < MAX_MODULES)
+      return modules;
+
+   return 0;
+}
+
+/** \brief Builds the token that module tokenIndex passes to its successor */
+void ModuleDiscovery::MakeToken(uint32_t data[2], uint8_t tokenIndex)
+{
+   uint8_t firstNodeId = nodeId - index;
+
+   data[0] = 0;
+   data[1] = firstNodeId + tokenIndex + 1;
+   data[1] |= (tokenIndex + 1) << 8;
+   data[1] |= pdobase << 16;
+}
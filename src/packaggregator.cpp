@@ -0,0 +1,246 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "packaggregator.h"
+#include "bmsio.h"
+
+#define NO_HOLDER -1
+
+ModuleData PackAggregator::data[MAX_MODULES];
+uint32_t PackAggregator::lastRx[MAX_MODULES];
+uint32_t PackAggregator::freshMask = 0;
+uint32_t PackAggregator::staleMask = 0;
+uint8_t PackAggregator::numModules = 0;
+uint32_t PackAggregator::sum = 0;
+uint16_t PackAggregator::cells = 0;
+uint16_t PackAggregator::umin = 0xFFFF;
+uint16_t PackAggregator::umax = 0;
+int8_t PackAggregator::tempmin = NO_TEMP;
+int8_t PackAggregator::tempmax = -40;
+int8_t PackAggregator::uminHolder = NO_HOLDER;
+int8_t PackAggregator::umaxHolder = NO_HOLDER;
+int8_t PackAggregator::tminHolder = NO_HOLDER;
+int8_t PackAggregator::tmaxHolder = NO_HOLDER;
+
+/** \brief Forgets all module data, e.g. after enumeration
+ *
+ * \param modules number of modules in the chain
+ * \param timeMs current time, every module gets one timeout to send its first data
+ *
+ */
+void PackAggregator::Reset(uint8_t modules, uint32_t timeMs)
+{
+   numModules = modules < MAX_MODULES ? modules : MAX_MODULES;
+   freshMask = 0;
+   staleMask = 0;
+   sum = 0;
+   cells = 0;
+
+   for (int i = 0; i < MAX_MODULES; i++)
+   {
+      data[i] = ModuleData();
+      lastRx[i] = timeMs;
+   }
+
+   Rescan();
+}
+
+/** \brief Replaces the contribution of one module with new data
+ *
+ * \param mod module index
+ * \param moduleData data as received from the module
+ * \param timeMs receive time stamp
+ *
+ */
+void PackAggregator::Update(uint8_t mod, const ModuleData& moduleData, uint32_t timeMs)
+{
+   if (mod >= numModules) return;
+
+   if (IsFresh(mod))
+      Remove(mod);
+
+   data[mod] = moduleData;
+   lastRx[mod] = timeMs;
+   freshMask |= 1 << mod;
+   staleMask &= ~(1 << mod);
+   Add(mod);
+}
+
+/** \brief Starts over with a module that restarted or joined the chain
+ *
+ * \param mod module index, may be one past the current chain
+ * \param timeMs current time, the module gets one timeout to send its first data
+ *
+ */
+void PackAggregator::Readmit(uint8_t mod, uint32_t timeMs)
+{
+   if (mod >= MAX_MODULES) return;
+
+   if (mod >= numModules)
+      numModules = mod + 1;
+
+   if (IsFresh(mod))
+   {
+      freshMask &= ~(1 << mod);
+      Remove(mod);
+   }
+
+   staleMask &= ~(1 << mod);
+   lastRx[mod] = timeMs;
+}
+
+/** \brief Drops modules that haven't reported in time
+ *
+ * \param timeMs current time
+ * \param timeoutMs maximum age of module data
+ * \return number of stale modules
+ *
+ */
+int PackAggregator::CheckFreshness(uint32_t timeMs, uint32_t timeoutMs)
+{
+   int stale = 0;
+
+   for (int i = 0; i < numModules; i++)
+   {
+      //Signed, a PDO may have arrived after timeMs was taken
+      if ((int32_t)(timeMs - lastRx[i]) > (int32_t)timeoutMs)
+      {
+         if (IsFresh(i))
+         {
+            freshMask &= ~(1 << i);
+            Remove(i);
+         }
+         staleMask |= 1 << i;
+         stale++;
+      }
+   }
+   return stale;
+}
+
+void PackAggregator::Add(uint8_t mod)
+{
+   const ModuleData& d = data[mod];
+
+   sum += d.uavg * d.numChan;
+   cells += d.numChan;
+
+   if (d.umin <= umin)
+   {
+      umin = d.umin;
+      uminHolder = mod;
+   }
+   else if (uminHolder == mod)
+   {
+      Rescan(); //The minimum moved up, another module may hold it now
+      return;
+   }
+
+   if (d.umax >= umax)
+   {
+      umax = d.umax;
+      umaxHolder = mod;
+   }
+   else if (umaxHolder == mod)
+   {
+      Rescan();
+      return;
+   }
+
+   if (d.tempmin >= NO_TEMP)
+   {
+      if (tminHolder == mod || tmaxHolder == mod)
+         Rescan(); //Module lost its sensors
+      return;
+   }
+
+   if (d.tempmin <= tempmin)
+   {
+      tempmin = d.tempmin;
+      tminHolder = mod;
+   }
+   else if (tminHolder == mod)
+   {
+      Rescan();
+      return;
+   }
+
+   if (d.tempmax >= tempmax)
+   {
+      tempmax = d.tempmax;
+      tmaxHolder = mod;
+   }
+   else if (tmaxHolder == mod)
+   {
+      Rescan();
+   }
+}
+
+/** \brief Removes the sum contribution of a module. The extremes are left in
+ * place when the module is updated, Add() takes care of them.
+ */
+void PackAggregator::Remove(uint8_t mod)
+{
+   const ModuleData& d = data[mod];
+
+   sum -= d.uavg * d.numChan;
+   cells -= d.numChan;
+
+   //Module is dropped, not updated
+   if (!IsFresh(mod) && (uminHolder == mod || umaxHolder == mod || tminHolder == mod || tmaxHolder == mod))
+      Rescan();
+}
+
+void PackAggregator::Rescan()
+{
+   umin = 0xFFFF;
+   umax = 0;
+   tempmin = NO_TEMP;
+   tempmax = -40;
+   uminHolder = umaxHolder = tminHolder = tmaxHolder = NO_HOLDER;
+
+   for (int i = 0; i < numModules; i++)
+   {
+      const ModuleData& d = data[i];
+
+      if (!IsFresh(i)) continue;
+
+      if (d.umin <= umin)
+      {
+         umin = d.umin;
+         uminHolder = i;
+      }
+      if (d.umax >= umax)
+      {
+         umax = d.umax;
+         umaxHolder = i;
+      }
+      if (d.tempmin < NO_TEMP)
+      {
+         if (d.tempmin <= tempmin)
+         {
+            tempmin = d.tempmin;
+            tminHolder = i;
+         }
+         if (d.tempmax >= tempmax)
+         {
+            tempmax = d.tempmax;
+            tmaxHolder = i;
+         }
+      }
+   }
+}
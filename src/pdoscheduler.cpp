@@ -0,0 +1,127 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "pdoscheduler.h"
+#include "my_math.h"
+
+#define TICK_MS 10
+
+PdoScheduler::Message PdoScheduler::messages[PDO_MAX_MESSAGES];
+int PdoScheduler::numMessages = 0;
+uint32_t PdoScheduler::ticks = 0;
+
+/** \brief Removes all messages */
+void PdoScheduler::Clear()
+{
+   numMessages = 0;
+}
+
+/** \brief Adds a message
+ *
+ * \param canId CAN id of the message
+ * \param period how often the content is checked for changes
+ * \param maxSilenceMs send at least this often, even without changes
+ * \param counterOffset bit position of the 2 bit sequence counter
+ * \return message index for AddField(), -1 if no more space
+ *
+ */
+int PdoScheduler::AddMessage(uint32_t canId, Period period, uint16_t maxSilenceMs, uint8_t counterOffset)
+{
+   if (numMessages >= PDO_MAX_MESSAGES) return -1;
+
+   Message& msg = messages[numMessages];
+   msg.canId = canId;
+   msg.period = period;
+   msg.numFields = 0;
+   msg.counterOffset = counterOffset;
+   msg.counter = 0;
+   msg.maxSilence = maxSilenceMs / TICK_MS;
+   msg.silence = msg.maxSilence; //Send on first opportunity
+
+   return numMessages++;
+}
+
+/** \brief Adds a parameter to a message, encoding is the same as CanMap::AddSend()
+ *
+ * \param msg message index returned by AddMessage()
+ * \param param parameter to send
+ * \param offset bit position
+ * \param length number of bits
+ * \param gain factor applied before sending
+ * \param deadband minimum change in parameter units that triggers sending
+ * \return false if the message is full
+ *
+ */
+bool PdoScheduler::AddField(int msg, Param::PARAM_NUM param, uint8_t offset, uint8_t length, float gain, float deadband)
+{
+   if (msg < 0 || msg >= numMessages || messages[msg].numFields >= PDO_MAX_FIELDS) return false;
+
+   Field& field = messages[msg].fields[messages[msg].numFields++];
+   field.param = param;
+   field.offset = offset;
+   field.length = length;
+   field.gain = gain;
+   field.deadband = deadband;
+   field.lastValue = 0;
+
+   return true;
+}
+
+/** \brief Sends all messages that are due, call every 10 ms */
+void PdoScheduler::Run(CanHardware* can)
+{
+   ticks++;
+
+   for (int i = 0; i < numMessages; i++)
+   {
+      Message& msg = messages[i];
+
+      if (msg.silence < msg.maxSilence)
+         msg.silence++;
+
+      if ((ticks % msg.period) != 0) continue;
+
+      bool changed = msg.silence >= msg.maxSilence;
+
+      for (int f = 0; f < msg.numFields && !changed; f++)
+      {
+         Field& field = msg.fields[f];
+         changed = ABS(Param::GetFloat(field.param) - field.lastValue) > field.deadband;
+      }
+
+      if (!changed) continue;
+
+      uint64_t frame = (uint64_t)msg.counter << msg.counterOffset;
+
+      for (int f = 0; f < msg.numFields; f++)
+      {
+         Field& field = msg.fields[f];
+         float value = Param::GetFloat(field.param);
+         uint64_t mask = (1ULL << field.length) - 1;
+         int32_t raw = value * field.gain;
+
+         frame |= ((uint64_t)raw & mask) << field.offset;
+         field.lastValue = value;
+      }
+
+      uint32_t data[2] = { (uint32_t)frame, (uint32_t)(frame >> 32) };
+      can->Send(msg.canId, data);
+      msg.counter = (msg.counter + 1) & 0x3;
+      msg.silence = 0;
+   }
+}
@@ -0,0 +1,199 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "selfdischarge.h"
+#include "bmsalgo.h"
+#include "my_math.h"
+
+#define SETTLE_TIME       1800 //Wait 30 minutes for the cells to relax before the first sample
+#define SAMPLE_INTERVAL   600  //Then sample every 10 minutes
+#define MIN_SAMPLES       12   //Need at least 2 hours of data for a usable slope
+
+float SelfDischarge::nominalCapacity = 100;
+float SelfDischarge::leakage[SD_MAX_CELLS];
+float SelfDischarge::lastLeakage[SD_MAX_CELLS];
+float SelfDischarge::meanU[SD_MAX_CELLS];
+float SelfDischarge::covTU[SD_MAX_CELLS];
+float SelfDischarge::balanceCharge[SD_MAX_CELLS];
+float SelfDischarge::meanT;
+float SelfDischarge::varT;
+float SelfDischarge::voltagePerCharge;
+uint32_t SelfDischarge::restStart;
+uint32_t SelfDischarge::lastSample;
+int SelfDischarge::numSamples;
+int SelfDischarge::cellCount;
+bool SelfDischarge::resting = false;
+bool SelfDischarge::valid = false;
+bool SelfDischarge::lastValid = false;
+
+/** \brief Tracks rest periods and decides when the next OCV sample is due
+ *
+ * \param timeSec free running time in seconds
+ * \param rest true while the pack is at rest, i.e. in IDLE state
+ * \return true if the caller should pass the cell voltages to AddSample()
+ *
+ */
+bool SelfDischarge::Run(uint32_t timeSec, bool rest)
+{
+   if (rest && !resting)
+   {
+      StartRest(timeSec);
+   }
+   else if (!rest && resting)
+   {
+      //Keep the result of this rest as starting point for the next one
+      for (int i = 0; i < SD_MAX_CELLS; i++)
+         lastLeakage[i] = leakage[i];
+      lastValid = valid;
+   }
+
+   resting = rest;
+
+   if (!resting || (timeSec - restStart) < SETTLE_TIME)
+      return false;
+
+   return numSamples == 0 || (timeSec - lastSample) >= SAMPLE_INTERVAL;
+}
+
+/** \brief Adds one open circuit voltage sample of all cells to the drift fit
+ *
+ * We don't look at the absolute voltage drift, which is dominated by the common
+ * self discharge and temperature. Instead we fit the drift of each cell relative
+ * to the module average. The charge the balancer moved into or out of a cell is
+ * converted to the voltage shift it caused and removed before fitting.
+ *
+ * \param timeSec free running time in seconds
+ * \param voltages cell voltages in mV
+ * \param numCells number of valid entries in voltages
+ *
+ */
+void SelfDischarge::AddSample(uint32_t timeSec, const float* voltages, int numCells)
+{
+   float avgU = 0, avgBalance = 0;
+
+   numCells = MIN(numCells, SD_MAX_CELLS);
+   lastSample = timeSec;
+
+   for (int i = 0; i < numCells; i++)
+   {
+      avgU += voltages[i];
+      avgBalance += balanceCharge[i];
+   }
+   avgU /= numCells;
+   avgBalance /= numCells;
+
+   if (numSamples == 0)
+   {
+      cellCount = numCells;
+      voltagePerCharge = CalculateVoltagePerCharge(avgU);
+   }
+
+   //Outside of the OCV table we can't translate voltage to charge
+   if (voltagePerCharge <= 0 || numCells != cellCount) return;
+
+   //Rest time in hours, the running (co)variance keeps this numerically stable over days
+   float t = (timeSec - restStart) / 3600.0f;
+   numSamples++;
+   float dt = t - meanT;
+   meanT += dt / numSamples;
+   varT += dt * (t - meanT);
+
+   for (int i = 0; i < numCells; i++)
+   {
+      float u = voltages[i] - avgU - (balanceCharge[i] - avgBalance) * voltagePerCharge;
+      meanU[i] += (u - meanU[i]) / numSamples;
+      covTU[i] += dt * (u - meanU[i]);
+   }
+
+   if (numSamples >= MIN_SAMPLES)
+      UpdateEstimate();
+}
+
+/** \brief Accounts for charge moved by the balancer during rest
+ *
+ * \param cell cell index
+ * \param charge charge in As, positive when charging the cell
+ *
+ */
+void SelfDischarge::AddBalancingCharge(int cell, float charge)
+{
+   if (resting && cell < SD_MAX_CELLS)
+      balanceCharge[cell] += charge;
+}
+
+/** \brief Returns the cell with the highest leakage relative to the module average */
+int SelfDischarge::GetWorstCell()
+{
+   int worst = 0;
+
+   for (int i = 1; i < cellCount; i++)
+   {
+      if (leakage[i] > leakage[worst])
+         worst = i;
+   }
+   return worst;
+}
+
+void SelfDischarge::StartRest(uint32_t timeSec)
+{
+   restStart = timeSec;
+   lastSample = timeSec;
+   numSamples = 0;
+   meanT = 0;
+   varT = 0;
+
+   for (int i = 0; i < SD_MAX_CELLS; i++)
+   {
+      meanU[i] = 0;
+      covTU[i] = 0;
+      balanceCharge[i] = 0;
+   }
+}
+
+void SelfDischarge::UpdateEstimate()
+{
+   if (varT <= 0) return;
+
+   for (int i = 0; i < cellCount; i++)
+   {
+      float slope = covTU[i] / varT; //mV/h relative to average
+      //mV/h -> As/h -> A -> mA. A cell that sags faster than average leaks more
+      float current = -slope / voltagePerCharge / 3.6f;
+
+      //Blend with the result of previous rests
+      leakage[i] = lastValid ? IIRFILTERF(lastLeakage[i], current, 2) : current;
+   }
+   valid = true;
+}
+
+/** \brief Calculates the slope of the OCV curve at a given voltage
+ *
+ * \param voltage cell voltage in mV
+ * \return OCV change in mV per As of charge, 0 if outside the table
+ *
+ */
+float SelfDischarge::CalculateVoltagePerCharge(float voltage)
+{
+   const float deltaU = 10;
+   float deltaSoc = BmsAlgo::EstimateSocFromVoltage(voltage + deltaU) - BmsAlgo::EstimateSocFromVoltage(voltage - deltaU);
+
+   if (deltaSoc <= 0) return 0;
+
+   float deltaCharge = deltaSoc * nominalCapacity * 3600.0f / 100.0f;
+   return (2 * deltaU) / deltaCharge;
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "statejournal.h"
+
+static_assert(sizeof(StateJournal::State) == (JOURNAL_RECORD_WORDS - 2) * sizeof(uint32_t), "Record size mismatch");
+
+/** \brief Builds a flash journal record
+ *
+ * \param s state to store
+ * \param sequence incremented on every record, binds the backup registers to it
+ * \param[out] record JOURNAL_RECORD_WORDS words, the flash log adds the CRC
+ *
+ */
+void StateJournal::EncodeRecord(const State& s, uint16_t sequence, uint32_t* record)
+{
+   record[0] = JOURNAL_VERSION;
+   record[1] = sequence;
+   memcpy(&record[2], &s, sizeof(State));
+}
+
+/** \brief Restores the state from a flash journal record
+ * \return false if size or version don't match
+ */
+bool StateJournal::DecodeRecord(const uint32_t* record, int words, State& s, uint16_t& sequence)
+{
+   if (words != JOURNAL_RECORD_WORDS || record[0] != JOURNAL_VERSION) return false;
+
+   sequence = record[1];
+   memcpy(&s, &record[2], sizeof(State));
+   return true;
+}
+
+/** \brief Builds the backup register block
+ *
+ * Only the charge counted since the last flash record is stored in As, the
+ * rest of the state changes rarely and is written to flash right away.
+ *
+ * \param s current state
+ * \param saved state of the last flash record
+ * \param sequence sequence number of the last flash record
+ * \param[out] regs JOURNAL_BACKUP_WORDS register values
+ *
+ */
+void StateJournal::EncodeBackup(const State& s, const State& saved, uint16_t sequence, uint16_t* regs)
+{
+   uint32_t in = s.chargeIn > saved.chargeIn ? s.chargeIn - saved.chargeIn : 0;
+   uint32_t out = s.chargeOut > saved.chargeOut ? s.chargeOut - saved.chargeOut : 0;
+
+   regs[0] = JOURNAL_MAGIC << 8 | JOURNAL_VERSION;
+   regs[1] = sequence;
+   regs[2] = in & 0xFFFF;
+   regs[3] = in >> 16;
+   regs[4] = out & 0xFFFF;
+   regs[5] = out >> 16;
+   regs[6] = Crc16(regs, JOURNAL_BACKUP_WORDS - 1);
+}
+
+/** \brief Adds the charge from the backup registers to a state restored from flash
+ *
+ * \param regs JOURNAL_BACKUP_WORDS register values
+ * \param sequence sequence number of the restored flash record
+ * \param[in,out] s state restored from flash
+ * \return false if the block is invalid or belongs to another flash record
+ *
+ */
+bool StateJournal::DecodeBackup(const uint16_t* regs, uint16_t sequence, State& s)
+{
+   if (regs[0] != (JOURNAL_MAGIC << 8 | JOURNAL_VERSION) || regs[1] != sequence) return false;
+   if (Crc16(regs, JOURNAL_BACKUP_WORDS - 1) != regs[JOURNAL_BACKUP_WORDS - 1]) return false;
+
+   s.chargeIn += regs[2] | ((uint32_t)regs[3] << 16);
+   s.chargeOut += regs[4] | ((uint32_t)regs[5] << 16);
+   return true;
+}
+
+/** \brief CRC-16/CCITT, the hardware CRC unit only does 32 bit words */
+uint16_t StateJournal::Crc16(const uint16_t* data, int len)
+{
+   uint16_t crc = 0xFFFF;
+
+   for (int i = 0; i < len; i++)
+   {
+      for (int shift = 8; shift >= 0; shift -= 8)
+      {
+         crc ^= ((data[i] >> shift) & 0xFF) << 8;
+
+         for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+   }
+   return crc;
+}
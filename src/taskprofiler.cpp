@@ -0,0 +1,159 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "taskprofiler.h"
+
+TaskProfiler::Stats TaskProfiler::stats[TASKPROF_MAX_TASKS];
+TaskProfiler::Deadline TaskProfiler::deadlines[TASKPROF_MAX_TASKS];
+//Upper bin edges in us, the last bin takes everything above
+const uint16_t TaskProfiler::jitterBins[TASKPROF_JITTER_BINS - 1] = { 20, 50, 100, 200, 500, 1000, 2000 };
+
+/** \brief Enables deadline monitoring of a task
+ *
+ * \param idx task index
+ * \param periodMs nominal period the task was added with
+ * \param toleranceUs maximum deviation of the start time
+ *
+ */
+void TaskProfiler::SetDeadline(int idx, uint32_t periodMs, uint32_t toleranceUs)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS) return;
+
+   deadlines[idx].period = periodMs * 1000 * TIMEBASE_CYCLES_PER_US;
+   deadlines[idx].tolerance = toleranceUs * TIMEBASE_CYCLES_PER_US;
+}
+
+/** \brief Checks the start time of a task against its nominal period
+ *
+ * \param idx task index
+ * \param start start time in CPU cycles
+ *
+ */
+void TaskProfiler::CheckStart(int idx, uint32_t start)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS) return;
+
+   Stats& s = stats[idx];
+   Deadline& d = deadlines[idx];
+
+   if (d.period > 0 && s.calls > 0)
+   {
+      uint32_t interval = start - s.lastStart;
+      uint32_t jitter = interval > d.period ? interval - d.period : d.period - interval;
+      uint32_t jitterUs = jitter / TIMEBASE_CYCLES_PER_US;
+      int bin = 0;
+
+      while (bin < (TASKPROF_JITTER_BINS - 1) && jitterUs > jitterBins[bin]) bin++;
+
+      s.jitter[bin]++;
+
+      if (jitter > d.tolerance)
+      {
+         s.late++;
+         d.violated = true;
+      }
+   }
+   s.lastStart = start;
+}
+
+/** \brief Adds one execution time to the statistics of a task
+ *
+ * \param idx task index
+ * \param cycles execution time in CPU cycles
+ *
+ */
+void TaskProfiler::Record(int idx, uint32_t cycles)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS) return;
+
+   Stats& s = stats[idx];
+
+   if (s.calls == 0 || cycles < s.min)
+      s.min = cycles;
+   if (cycles > s.max)
+      s.max = cycles;
+
+   s.sum += cycles;
+   s.calls++;
+
+   if (deadlines[idx].period > 0 && cycles > deadlines[idx].period)
+   {
+      s.overrun++;
+      deadlines[idx].violated = true;
+   }
+}
+
+/** \brief Returns whether the task was late or overran since the last call
+ * \param idx task index
+ */
+bool TaskProfiler::CheckViolation(int idx)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS) return false;
+
+   bool violated = deadlines[idx].violated;
+   deadlines[idx].violated = false;
+   return violated;
+}
+
+/** \brief Returns the number of starts that deviated from the period by the range of a bin
+ *
+ * \param idx task index
+ * \param bin histogram bin, upper edges are 20, 50, 100, 200, 500, 1000, 2000 us and infinity
+ * \return number of starts
+ *
+ */
+uint32_t TaskProfiler::GetJitterCount(int idx, int bin)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS || bin < 0 || bin >= TASKPROF_JITTER_BINS) return 0;
+   return stats[idx].jitter[bin];
+}
+
+/** \brief Returns a statistic of a task
+ *
+ * \param idx task index
+ * \param stat which figure, execution times are in CPU cycles
+ * \return the figure, 0 if the task never ran
+ *
+ */
+uint32_t TaskProfiler::GetStat(int idx, Stat stat)
+{
+   if (idx < 0 || idx >= TASKPROF_MAX_TASKS || stats[idx].calls == 0) return 0;
+
+   const Stats& s = stats[idx];
+
+   switch (stat)
+   {
+   case MIN: return s.min;
+   case AVG: return s.sum / s.calls;
+   case MAX: return s.max;
+   case CALLS: return s.calls;
+   case LATE: return s.late;
+   case OVERRUN: return s.overrun;
+   default: return 0;
+   }
+}
+
+/** \brief Clears the statistics of all tasks, deadlines are kept */
+void TaskProfiler::Reset()
+{
+   for (int i = 0; i < TASKPROF_MAX_TASKS; i++)
+   {
+      stats[i] = Stats();
+      deadlines[i].violated = false;
+   }
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "thermalmodel.h"
+
+float ThermalModel::cellResistance = 0.001f;
+float ThermalModel::cellHeatCapacity = 1000;
+float ThermalModel::cellThermalResistance = 0.5f;
+float ThermalModel::timeStep = 0.1f;
+
+/** \brief Advances the model by one time step
+ *
+ * \param current cell current in A
+ * \param surfaceTemp measured surface temperature in °C
+ * \return predicted core temperature in °C
+ *
+ */
+float ThermalModel::Run(float current, float surfaceTemp)
+{
+   if (!initialized)
+   {
+      //Assume thermal equilibrium at start up
+      coreTemp = surfaceTemp;
+      initialized = true;
+   }
+
+   float heat = current * current * cellResistance;
+   float heatToSurface = (coreTemp - surfaceTemp) / cellThermalResistance;
+
+   coreTemp += timeStep * (heat - heatToSurface) / cellHeatCapacity;
+
+   return coreTemp;
+}
+
+/** \brief Sets the thermal properties of a single cell
+ *
+ * \param resistance internal resistance in Ohm
+ * \param heatCapacity heat capacity of the core in J/K
+ * \param thermalResistance thermal resistance from core to surface in K/W
+ *
+ */
+void ThermalModel::SetCellParameters(float resistance, float heatCapacity, float thermalResistance)
+{
+   cellResistance = resistance;
+   cellHeatCapacity = heatCapacity;
+   cellThermalResistance = thermalResistance;
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "timepredictor.h"
+#include "bmsalgo.h"
+#include "my_math.h"
+
+#define SOC_STEP          0.5f //Simulation step in %
+#define STEPS_PER_CALL    10   //Simulation steps per call of Run()
+#define SOC_CHANGE        SOC_STEP //Restart simulation when the SoC moved this much
+#define TEMP_CHANGE       2    //or the temperature moved this many °C
+#define DERATING_CHANGE   0.05f //or the derating factor moved this much
+
+float TimePredictor::targetSoc = 80;
+float TimePredictor::capacity = 100;
+float TimePredictor::resistance = 1;
+float TimePredictor::cutoffCurrent = 2;
+float TimePredictor::startSoc;
+float TimePredictor::startTemp;
+float TimePredictor::startDerating;
+float TimePredictor::simSoc;
+float TimePredictor::simTime;
+float TimePredictor::simTimeToTarget;
+float TimePredictor::timeToTarget = 0;
+float TimePredictor::timeToFull = 0;
+bool TimePredictor::restart = true;
+bool TimePredictor::running = false;
+
+/** \brief Advances the charge time prediction
+ *
+ * The charge is simulated forward in SoC steps through the steady state of the
+ * charge profile. Only a few steps are calculated per call, the results are
+ * updated once the simulation reaches full. A new simulation is only started
+ * when the inputs changed significantly.
+ * If the profile current drops below the cutoff before the target SoC, the
+ * time to target is TIME_UNREACHABLE. The time to full is only TIME_UNREACHABLE
+ * when no charge is possible at all, otherwise the charge ends at the cutoff.
+ *
+ * \param soc present state of charge in %
+ * \param lowTemp lowest cell temperature in °C
+ * \param derating temperature derating factor applied to the charge current
+ *
+ */
+void TimePredictor::Run(float soc, float lowTemp, float derating)
+{
+   if (restart ||
+       ABS(soc - startSoc) >= SOC_CHANGE ||
+       ABS(lowTemp - startTemp) >= TEMP_CHANGE ||
+       ABS(derating - startDerating) >= DERATING_CHANGE)
+   {
+      Start(soc, lowTemp, derating);
+   }
+
+   if (!running) return;
+
+   for (int i = 0; i < STEPS_PER_CALL && running; i++)
+      running = Step();
+
+   if (!running)
+   {
+      //Stopping below the cutoff current before the first step means no charge at all
+      bool charging = simSoc > startSoc || simSoc >= 100;
+      timeToFull = charging ? simTime / 60 : TIME_UNREACHABLE;
+      timeToTarget = simSoc >= targetSoc ? simTimeToTarget / 60 : TIME_UNREACHABLE;
+   }
+}
+
+/** \brief Calculates the time until the battery is empty at the given power
+ *
+ * \param soc present state of charge in %
+ * \param power average battery power in W, negative when discharging
+ * \param numCells number of series cells
+ * \return time to empty in minutes, 0 when not discharging
+ *
+ */
+float TimePredictor::CalculateTimeToEmpty(float soc, float power, int numCells)
+{
+   if (power >= 0 || numCells <= 0) return 0;
+
+   //Integrate the open circuit voltage over the remaining charge
+   float energy = 0;
+
+   for (float s = 0; s < soc; s += 10)
+   {
+      float ds = MIN(10, soc - s);
+      float u = (BmsAlgo::EstimateVoltageFromSoc(s) + BmsAlgo::EstimateVoltageFromSoc(s + ds)) / 2;
+      energy += u * ds;
+   }
+
+   //mV * % -> V * fraction, Ah -> As -> Ws
+   energy *= numCells * capacity * 3600.0f / 100000.0f;
+
+   return energy / -power / 60;
+}
+
+void TimePredictor::SetTarget(float soc)
+{
+   targetSoc = soc;
+   restart = true;
+}
+
+void TimePredictor::SetCapacity(float ah)
+{
+   capacity = ah;
+   restart = true;
+}
+
+/** \brief Sets the internal cell resistance in mOhm */
+void TimePredictor::SetCellResistance(float r)
+{
+   resistance = r;
+   restart = true;
+}
+
+void TimePredictor::SetCutoffCurrent(float i)
+{
+   cutoffCurrent = i;
+   restart = true;
+}
+
+void TimePredictor::Start(float soc, float lowTemp, float derating)
+{
+   startSoc = soc;
+   startTemp = lowTemp;
+   startDerating = derating;
+   simSoc = soc;
+   simTime = 0;
+   simTimeToTarget = 0;
+   restart = false;
+   running = true;
+}
+
+/** \brief Calculates one simulation step
+ * \return true if more steps are needed
+ */
+bool TimePredictor::Step()
+{
+   if (simSoc >= 100) return false;
+
+   float ds = MIN(SOC_STEP, 100 - simSoc);
+   float current = BmsAlgo::GetProfileCurrent(simSoc + ds / 2, resistance, startTemp) * startDerating;
+
+   if (current < cutoffCurrent) return false;
+
+   //% of Ah -> As
+   simTime += ds * capacity * 36 / current;
+   simSoc += ds;
+
+   if (simSoc <= targetSoc)
+      simTimeToTarget = simTime;
+
+   return true;
+}
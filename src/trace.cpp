@@ -0,0 +1,96 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "trace.h"
+
+#ifdef STM32F1
+#include "timebase.h"
+static uint32_t GetCycles() { return TimeBase::GetCycles(); }
+static uint32_t GetMillis() { return TimeBase::GetMillis(); }
+#else
+//Host builds only check ordering and contents
+static uint32_t GetCycles() { return 0; }
+static uint32_t GetMillis() { return 0; }
+#endif
+
+Trace::Record Trace::records[TRACE_SIZE];
+volatile uint32_t Trace::head = 0;
+volatile uint32_t Trace::dropped = 0;
+volatile bool Trace::frozen = false;
+
+/** \brief Appends a record, lock free
+ *
+ * \param type event type
+ * \param arg8 first event argument, see tracedecode.py for their meaning
+ * \param arg16 second event argument
+ *
+ */
+void Trace::Add(Type type, uint8_t arg8, int16_t arg16)
+{
+   if (frozen)
+   {
+      __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+
+   uint32_t slot = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+   Record& r = records[slot & (TRACE_SIZE - 1)];
+
+   //Invalidate first so a reader never sees old and new fields mixed
+   __atomic_store_n(&r.type, (uint8_t)TR_NONE, __ATOMIC_RELEASE);
+   r.cycles = GetCycles();
+   r.millis = GetMillis();
+   r.arg8 = arg8;
+   r.arg16 = arg16;
+   __atomic_store_n(&r.type, (uint8_t)type, __ATOMIC_RELEASE);
+}
+
+/** \brief Reads one word of a record
+ *
+ * \param record record number, 0 is the oldest one still in the buffer
+ * \param word 0: cycles, 1: milliseconds, 2: type | arg8 << 8 | arg16 << 16
+ * \param[out] value word content
+ * \return false if the record doesn't exist
+ *
+ */
+bool Trace::GetWord(uint32_t record, int word, uint32_t& value)
+{
+   uint32_t end = head;
+   uint32_t count = end < TRACE_SIZE ? end : TRACE_SIZE;
+
+   if (record >= count || word < 0 || word >= TRACE_WORDS) return false;
+
+   const Record& r = records[(end - count + record) & (TRACE_SIZE - 1)];
+
+   switch (word)
+   {
+   case 0: value = r.cycles; break;
+   case 1: value = r.millis; break;
+   default: value = r.type | (r.arg8 << 8) | ((uint32_t)(uint16_t)r.arg16 << 16); break;
+   }
+   return true;
+}
+
+void Trace::Clear()
+{
+   for (int i = 0; i < TRACE_SIZE; i++)
+      records[i].type = TR_NONE;
+
+   head = 0;
+   dropped = 0;
+}
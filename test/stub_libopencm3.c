@@ -16,7 +16,44 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#define _DEFAULT_SOURCE //for MAP_ANONYMOUS
 #include "stdint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+/* Flash is emulated in RAM mapped at the real flash address, so code that
+ * does address arithmetic in 32 bit works unchanged on 64 bit hosts */
+#define FLASH_ADDRESS    0x08000000
+#define FLASH_SIZE_KB    16
+#define FLASH_PAGE_BYTES 1024
+
+static uint32_t crcValue = 0xFFFFFFFF;
+
+static void map_flash(void)
+{
+   static int mapped = 0;
+
+   if (!mapped)
+   {
+      //Never silently replace whatever the host already has at that address
+      void* flash = mmap((void*)FLASH_ADDRESS, FLASH_SIZE_KB * 1024, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+      if (flash == MAP_FAILED || flash != (void*)FLASH_ADDRESS)
+      {
+         fprintf(stderr, "Cannot map emulated flash at 0x%08x\n", FLASH_ADDRESS);
+         abort();
+      }
+      memset((void*)FLASH_ADDRESS, 0xFF, FLASH_SIZE_KB * 1024);
+      mapped = 1;
+   }
+}
 
 void flash_unlock(void)
 {
@@ -30,20 +67,45 @@ void flash_set_ws(uint32_t ws)
 {
 }
 
+/* Like NOR flash programming can only clear bits */
 void flash_program_word(uint32_t address, uint32_t data)
 {
+   map_flash();
+   *(volatile uint32_t*)(uintptr_t)address &= data;
 }
 
 void flash_erase_page(uint32_t page_address)
 {
+   map_flash();
+   memset((void*)(uintptr_t)(page_address & ~(FLASH_PAGE_BYTES - 1)), 0xFF, FLASH_PAGE_BYTES);
 }
 
 uint16_t desig_get_flash_size(void)
 {
-    return 8;
+   map_flash();
+   return FLASH_SIZE_KB;
+}
+
+/* Same as the STM32 CRC unit: CRC-32 polynomial, MSB first, whole words */
+void crc_reset(void)
+{
+   crcValue = 0xFFFFFFFF;
 }
 
 uint32_t crc_calculate(uint32_t data)
 {
-    return 0xaa55;
+   crcValue ^= data;
+
+   for (int i = 0; i < 32; i++)
+      crcValue = (crcValue & 0x80000000) ? (crcValue << 1) ^ 0x04C11DB7 : crcValue << 1;
+
+   return crcValue;
+}
+
+uint32_t crc_calculate_block(uint32_t *datap, int size)
+{
+   for (int i = 0; i < size; i++)
+      crc_calculate(datap[i]);
+
+   return crcValue;
 }
@@ -21,6 +21,7 @@
 
 #include "test.h"
 #include "bmsalgo.h"
+#include "my_math.h"
 
 class BmsAlgoTest: public UnitTest
 {
@@ -39,11 +40,36 @@ void BmsAlgoTest::TestCaseSetup()
    BmsAlgo::SetNominalCapacity(100);
    BmsAlgo::SetMinVoltage(3300, 100);
    BmsAlgo::SetControllerGains(1, 1);
-   BmsAlgo::SetCCCVCurve(0, 400, 3900);
-   BmsAlgo::SetCCCVCurve(1, 200, 4100);
-   BmsAlgo::SetCCCVCurve(2, 100, 4200);
+   BmsAlgo::SetChargeStage(0, 400, 3900, -40);
+   BmsAlgo::SetChargeStage(1, 200, 4100, -40);
+   BmsAlgo::SetChargeStage(2, 100, 4200, -40);
+   BmsAlgo::SetNumChargeStages(3);
 }
 
+//Simple cell model: open circuit voltage from a 10% step table plus ohmic drop
+static float CellVoltage(const uint16_t* ocv, float soc, float current, float resistance)
+{
+   int idx = MIN(9, MAX(0, (int)(soc / 10)));
+   float frac = (soc - idx * 10) / 10;
+   return ocv[idx] + (ocv[idx + 1] - ocv[idx]) * frac + current * resistance;
+}
+
+//Charges a 100 Ah cell at 25°C and returns the charge time in hours
+static float SimulateCharge(const uint16_t* ocv, float resistance, float& soc, float hystVoltage, float icutoff)
+{
+   float current = 0;
+   int ticks;
+
+   for (ticks = 0; ticks < 10 * 3600 * 10; ticks++) //give up after 10 h at 10 Hz
+   {
+      current = BmsAlgo::GetChargeCurrent(CellVoltage(ocv, soc, current, resistance), hystVoltage, icutoff, 25);
+      if (current <= 0) break;
+      soc += current * 0.1f / 3600; //As -> % of 100 Ah
+   }
+   return ticks / 36000.0f;
+}
+
+
 static void TestEstimateSocFromVoltage()
 {
    float soc = BmsAlgo::EstimateSocFromVoltage(3650);
@@ -82,7 +108,7 @@ static void TestGetChargeCurrent1()
 {
    float current;
    for (int i = 0; i < 30; i++) //run 20 loops for integrator to reach steady state
-      current = BmsAlgo::GetChargeCurrent(3800, 3800, 0); //100 mV away from CV point
+      current = BmsAlgo::GetChargeCurrent(3800, 3800, 0, 25); //100 mV away from CV point
    ASSERT(current == 400);
 }
 
@@ -91,18 +117,64 @@ static void TestGetChargeCurrent2()
    float current;
 
    for (int i = 0; i < 500; i++) //run 200 loops (20s) for integrator to reach steady state
-      current = BmsAlgo::GetChargeCurrent(3850 + current * 0.15, 4200, 0); //simulate internal resistance
+      current = BmsAlgo::GetChargeCurrent(3850 + current * 0.15, 4200, 0, 25); //simulate internal resistance
    ASSERT(current == 333); //333A because 3850 + 333 * 0.15 == 3900
 
    for (int i = 0; i < 30; i++) //run 10 loops (1s) for integrator to reach steady state
-      current = BmsAlgo::GetChargeCurrent(3900 + current * 0.15, 4200, 0); //simulate internal resistance
+      current = BmsAlgo::GetChargeCurrent(3900 + current * 0.15, 4200, 0, 25); //simulate internal resistance
    ASSERT(current == 200); //in second CCCV stage
 
    for (int i = 0; i < 150; i++) //run 50 loops (5s) for integrator to reach steady state
-      current = BmsAlgo::GetChargeCurrent(4205 + current * 0.15, 4200, 0); //simulate internal resistance
+      current = BmsAlgo::GetChargeCurrent(4205 + current * 0.15, 4200, 0, 25); //simulate internal resistance
    ASSERT(current == 0); //333A because 3850 + 333 * 0.15 == 3900
 }
 
+static void TestChargeStageTemperatureWindow()
+{
+   float current;
+
+   BmsAlgo::SetChargeStage(0, 400, 3900, 15); //Highest current only above 15°C
+   BmsAlgo::GetChargeCurrent(4300, 4200, 0, 25); //Make sure we start a fresh charge
+
+   for (int i = 0; i < 30; i++)
+      current = BmsAlgo::GetChargeCurrent(3800, 3800, 0, 10);
+   ASSERT(current == 200 && BmsAlgo::GetActiveChargeStage() == 1);
+
+   for (int i = 0; i < 30; i++) //Warmed up, go back to first stage
+      current = BmsAlgo::GetChargeCurrent(3800, 3800, 0, 20);
+   ASSERT(current == 400 && BmsAlgo::GetActiveChargeStage() == 0);
+}
+
+static void TestVwLikeChargeProfile()
+{
+   const uint16_t ocv[] = { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
+   float soc = 10;
+
+   BmsAlgo::SetChargeStage(0, 250, 3950, -40);
+   BmsAlgo::SetChargeStage(1, 175, 4050, -40);
+   BmsAlgo::SetChargeStage(2, 125, 4120, -40);
+   BmsAlgo::SetChargeStage(3, 75, 4200, -40);
+   BmsAlgo::SetNumChargeStages(4);
+
+   float hours = SimulateCharge(ocv, 0.6f, soc, 4150, 5);
+   std::cout << "VW-like profile 10% -> " << soc << "% in " << hours * 60 << " min" << std::endl;
+   ASSERT(soc > 95 && hours < 1.2f);
+}
+
+static void TestLfpChargeProfile()
+{
+   const uint16_t ocv[] = { 2800, 3200, 3250, 3280, 3300, 3310, 3320, 3330, 3340, 3380, 3600 };
+   float soc = 10;
+
+   BmsAlgo::SetChargeStage(0, 100, 3450, -40);
+   BmsAlgo::SetChargeStage(1, 30, 3550, -40);
+   BmsAlgo::SetNumChargeStages(2);
+
+   float hours = SimulateCharge(ocv, 0.5f, soc, 3400, 3);
+   std::cout << "LFP profile 10% -> " << soc << "% in " << hours * 60 << " min" << std::endl;
+   ASSERT(soc > 95 && hours < 1.5f);
+}
+
 static void TestLimitMinimumCellVoltage()
 {
    float current;
@@ -158,4 +230,5 @@ static void TestHighTemperatureDerating()
 //This line registers the test
 REGISTER_TEST(BmsAlgoTest, TestEstimateSocFromVoltage, TestCalculateSocFromIntegration,
               TestCalculateSoH, TestGetChargeCurrent1, TestGetChargeCurrent2,
+              TestChargeStageTemperatureWindow, TestVwLikeChargeProfile, TestLfpChargeProfile,
               TestLimitMinimumCellVoltage, TestLowTemperatureDerating, TestHighTemperatureDerating);
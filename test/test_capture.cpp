@@ -0,0 +1,91 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "capture.h"
+
+class CaptureTest: public UnitTest
+{
+   public:
+      CaptureTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestLevelTrigger()
+{
+   uint32_t value = 0;
+   int i = 0;
+
+   Capture::SetLevel(100);
+   Capture::SetPreTrigger(16);
+   Capture::Arm(Capture::TRIG_LEVEL);
+
+   for (; i < 1000 && Capture::GetState() == Capture::CAP_ARMED; i++)
+      Capture::AddSample(i, 0, i == 500 ? 150 : 10);
+
+   ASSERT(Capture::GetTriggerSource() == Capture::TRIG_LEVEL);
+   ASSERT(!Capture::GetSample(0, value)); //Still recording
+
+   for (; Capture::IsActive(); i++)
+      Capture::AddSample(i, 0, 10);
+
+   ASSERT(Capture::GetState() == Capture::CAP_DONE);
+   ASSERT(Capture::GetCount() == CAPTURE_SIZE);
+   ASSERT(Capture::GetTriggerIndex() == 16);
+   ASSERT(Capture::GetSample(16, value) && value == 500);
+   ASSERT(Capture::GetSample(0, value) && value == 484);
+   ASSERT(Capture::GetSample(CAPTURE_SIZE - 1, value) && value == 500 + CAPTURE_SIZE - 17);
+}
+
+static void TestSlopeTrigger()
+{
+   Capture::SetSlope(50);
+   Capture::Arm(Capture::TRIG_SLOPE);
+
+   Capture::AddSample(0, 0, 200); //First sample has no slope
+   Capture::AddSample(0, 0, 240);
+   ASSERT(Capture::GetState() == Capture::CAP_ARMED);
+   Capture::AddSample(0, 0, 180);
+   ASSERT(Capture::GetState() == Capture::CAP_TRIGGERED);
+   ASSERT(Capture::GetTriggerSource() == Capture::TRIG_SLOPE);
+}
+
+static void TestExternalTrigger()
+{
+   uint32_t value = 0;
+
+   Capture::SetPreTrigger(4);
+   Capture::Arm(Capture::TRIG_STATE);
+   Capture::Trigger(Capture::TRIG_MANUAL); //Not enabled
+
+   for (int i = 0; i < 10; i++)
+      Capture::AddSample(i, -i, 0);
+
+   ASSERT(Capture::GetState() == Capture::CAP_ARMED);
+   Capture::Trigger(Capture::TRIG_STATE);
+
+   for (int i = 10; Capture::IsActive(); i++)
+      Capture::AddSample(i, -i, 0);
+
+   //The trigger falls between sample 9 and 10
+   ASSERT(Capture::GetTriggerIndex() == 4);
+   ASSERT(Capture::GetSample(4, value) && value == (10 | (0xFFF6u << 16)));
+   Capture::Arm(0);
+   ASSERT(Capture::GetState() == Capture::CAP_DONE); //Disarming keeps the result
+}
+
+REGISTER_TEST(CaptureTest, TestLevelTrigger, TestSlopeTrigger, TestExternalTrigger);
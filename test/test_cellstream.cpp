@@ -0,0 +1,53 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "cellstream.h"
+
+class CellStreamTest: public UnitTest
+{
+   public:
+      CellStreamTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestEncodeReceive()
+{
+   const uint16_t frameCells[] = { 3300, 4200, 16383, 1 };
+   uint32_t data[2];
+
+   CellStream::Encode(2, frameCells, data);
+   CellStream::Receive(3, data);
+
+   ASSERT(CellStream::GetCell(3 * CELLSTREAM_MAX_CELLS + 8) == 3300);
+   ASSERT(CellStream::GetCell(3 * CELLSTREAM_MAX_CELLS + 9) == 4200);
+   ASSERT(CellStream::GetCell(3 * CELLSTREAM_MAX_CELLS + 10) == 16383);
+   ASSERT(CellStream::GetCell(3 * CELLSTREAM_MAX_CELLS + 11) == 1);
+}
+
+static void TestInvalidMux()
+{
+   const uint16_t frameCells[] = { 1000, 1000, 1000, 1000 };
+   uint32_t data[2];
+
+   CellStream::Encode(4, frameCells, data); //Beyond 16 cells
+   CellStream::Receive(4, data);
+   ASSERT(CellStream::GetCell(5 * CELLSTREAM_MAX_CELLS) == 0);
+}
+
+//This line registers the test
+REGISTER_TEST(CellStreamTest, TestEncodeReceive, TestInvalidMux);
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "currentframe.h"
+
+class CurrentFrameTest: public UnitTest
+{
+   public:
+      CurrentFrameTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestAveraging()
+{
+   uint32_t data[2];
+   int frames = 0;
+   float current = 0, dt = 0, charge = 0;
+
+   CurrentFrame::SetFrameRate(10);
+
+   //One second of a 100 A / 0 A square wave sampled at 200 Hz
+   for (int i = 1; i <= 200; i++)
+   {
+      if (CurrentFrame::Run((i / 10) & 1 ? 100 : 0, i * 5, data))
+      {
+         frames++;
+
+         if (CurrentFrame::Receive(data, current, dt))
+            charge += current * dt;
+      }
+   }
+
+   ASSERT(frames == 10);
+   ASSERT(dt > 0.0999f && dt < 0.1001f);
+   //The first frame only starts the integration, the other 9 carry 50 A average each
+   ASSERT(charge > 44.99f && charge < 45.01f);
+}
+
+static void TestFullRate()
+{
+   uint32_t data[2];
+
+   CurrentFrame::SetFrameRate(500); //Limited to 200
+   ASSERT(CurrentFrame::Run(-12.345f, 5000, data));
+   ASSERT((int32_t)data[0] == -12345);
+   ASSERT(CurrentFrame::Run(1, 5005, data));
+   ASSERT(data[1] == 5005);
+
+   //Turned off
+   int frames = 0;
+   CurrentFrame::SetFrameRate(0);
+   for (int i = 0; i < 200; i++)
+      frames += CurrentFrame::Run(1, 6000 + i * 5, data);
+   ASSERT(frames == 0);
+}
+
+static void TestGap()
+{
+   uint32_t data[2] = { 1000, 10000 };
+   float current, dt;
+
+   CurrentFrame::Receive(data, current, dt);
+   data[1] = 12000; //Sender was gone for 2 s
+   ASSERT(!CurrentFrame::Receive(data, current, dt));
+   ASSERT(current == 1);
+   data[1] = 12005;
+   ASSERT(CurrentFrame::Receive(data, current, dt));
+}
+
+//This line registers the test
+REGISTER_TEST(CurrentFrameTest, TestAveraging, TestFullRate, TestGap);
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+#include "cyclecounter.h"
+
+class CycleCounterTest: public UnitTest
+{
+   public:
+      CycleCounterTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void CycleCounterTest::TestCaseSetup()
+{
+   CycleCounter::Reset();
+}
+
+static void RampSoc(float from, float to)
+{
+   float step = to > from ? 0.1f : -0.1f;
+
+   for (float soc = from; (to - soc) * step > 0; soc += step)
+      CycleCounter::AddSoc(soc);
+   CycleCounter::AddSoc(to);
+}
+
+static void TestRepeatedCycles()
+{
+   RampSoc(90, 30);
+   //Three identical 60% cycles between 30 and 90%, mean SoC 60%
+   for (int i = 0; i < 3; i++)
+   {
+      RampSoc(30, 90);
+      RampSoc(90, 30);
+   }
+   RampSoc(30, 50);
+   //Every range includes the starting point so each is counted as half cycle.
+   //The last range 90% -> 30% stays in the residue
+   ASSERT(CycleCounter::GetHalfCycles(3, 6) == 6);
+}
+
+static void TestNestedCycle()
+{
+   RampSoc(20, 80);
+   RampSoc(80, 60); //small discharge
+   RampSoc(60, 70); //small recharge closes a 10% cycle around 65% SoC
+   RampSoc(70, 10);
+   RampSoc(10, 30);
+   ASSERT(CycleCounter::GetHalfCycles(3, 1) == 2);
+   ASSERT(CycleCounter::GetHalfCycles(2, 6) == 1); //20% -> 80% half cycle
+}
+
+static void TestNoiseIsIgnored()
+{
+   for (int i = 0; i < 1000; i++)
+      CycleCounter::AddSoc(50 + (i & 1) * 0.5f);
+
+   uint32_t total = 0;
+   for (int mean = 0; mean < CC_MEAN_BINS; mean++)
+      for (int depth = 0; depth < CC_DEPTH_BINS; depth++)
+         total += CycleCounter::GetHalfCycles(mean, depth);
+
+   ASSERT(total == 0);
+}
+
+static void TestThroughput()
+{
+   CycleCounter::AddCharge(0, 0);
+   CycleCounter::AddCharge(100 * 3600, 50 * 3600);
+   ASSERT(CycleCounter::GetThroughput() == 150);
+   ASSERT(CycleCounter::GetEquivalentFullCycles(75) == 1);
+}
+
+//This line registers the test
+REGISTER_TEST(CycleCounterTest, TestRepeatedCycles, TestNestedCycle, TestNoiseIsIgnored, TestThroughput);
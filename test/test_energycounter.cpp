@@ -0,0 +1,67 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "energycounter.h"
+
+class EnergyCounterTest: public UnitTest
+{
+   public:
+      EnergyCounterTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+/** \brief Feeds one hour of a constant current in 1 s steps, like BmsIO::IntegrateCurrent() */
+static void RunHour(float current, float voltage)
+{
+   for (int s = 0; s < 3600; s++)
+   {
+      if (current > 0)
+         EnergyCounter::Add(current, 0, voltage);
+      else
+         EnergyCounter::Add(0, -current, voltage);
+   }
+}
+
+static void TestSmallCurrent()
+{
+   EnergyCounter::SetTotals(0, 0);
+
+   //0.7 Wh per second, one 1/32 kWh step is 31 Wh
+   RunHour(2, 350);
+   ASSERT(EnergyCounter::GetIn() > 0.6995f && EnergyCounter::GetIn() < 0.7005f);
+   ASSERT(EnergyCounter::GetOut() == 0);
+
+   RunHour(-20, 350);
+   RunHour(-20, 350);
+   ASSERT(EnergyCounter::GetOut() > 13.999f && EnergyCounter::GetOut() < 14.001f);
+   ASSERT(EnergyCounter::GetIn() > 0.6995f && EnergyCounter::GetIn() < 0.7005f);
+}
+
+static void TestLargeTotal()
+{
+   //A restored total does not swallow small increments
+   EnergyCounter::SetTotals(20000.5f, 1.25f);
+   ASSERT(EnergyCounter::GetIn() == 20000.5f);
+
+   RunHour(0.4f, 350);
+   ASSERT(EnergyCounter::GetIn() > 20000.63f && EnergyCounter::GetIn() < 20000.65f);
+   ASSERT(EnergyCounter::GetOut() == 1.25f);
+}
+
+//This line registers the test
+REGISTER_TEST(EnergyCounterTest, TestSmallCurrent, TestLargeTotal);
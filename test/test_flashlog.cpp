@@ -0,0 +1,171 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <libopencm3/stm32/flash.h>
+#include "test.h"
+#include "flashlog.h"
+#include "flashstore.h"
+#include "lifetimestats.h"
+#include "hwdefs.h"
+
+#define TEST_BLKNUM 5
+
+class FlashLogTest: public UnitTest
+{
+   public:
+      FlashLogTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static int numRecords;
+static uint16_t lastType;
+static int lastWords;
+static uint32_t lastData[LS_SNAPSHOT_WORDS];
+
+static void CountRecord(uint16_t type, const uint32_t* data, int words)
+{
+   numRecords++;
+   lastType = type;
+   lastWords = words;
+   memcpy(lastData, data, words * sizeof(uint32_t));
+}
+
+static void ReplayStats(uint16_t type, const uint32_t* data, int words)
+{
+   if (type == LifetimeStats::REC_SNAPSHOT)
+      LifetimeStats::Load(data, words);
+   else if (type == LifetimeStats::REC_DELTA)
+      LifetimeStats::ApplyDelta(data, words);
+}
+
+static uint32_t GetCellTime(int cell)
+{
+   uint32_t time = 0;
+
+   for (int bin = 0; bin < LS_VOLTAGE_BINS; bin++)
+      time += LifetimeStats::GetVoltageTime(cell, bin);
+   return time;
+}
+
+static bool Reopen(FlashLog::RecordHandler handler)
+{
+   FlashLog log(TEST_BLKNUM);
+
+   numRecords = 0;
+   return log.Open(handler);
+}
+
+static void Format()
+{
+   flash_erase_page(FlashStore::GetBlockAddress(TEST_BLKNUM));
+   flash_erase_page(FlashStore::GetBlockAddress(TEST_BLKNUM + 1));
+}
+
+static void TestSnapshotAndAppend()
+{
+   FlashLog log(TEST_BLKNUM);
+   uint32_t snapshot[100], delta[5] = { 1, 2, 3, 4, 5 };
+
+   Format();
+   for (int i = 0; i < 100; i++) snapshot[i] = i;
+
+   ASSERT(!log.Open(CountRecord));
+   ASSERT(!log.Append(2, delta, 5)); //No page yet
+
+   log.StartPage(1, snapshot, 100);
+   ASSERT(log.GetFreeWords() == FLASH_PAGE_SIZE / 4 - 2 - 102);
+   ASSERT(log.Append(2, delta, 5));
+
+   ASSERT(Reopen(CountRecord));
+   ASSERT(numRecords == 2);
+   ASSERT(lastType == 2 && lastWords == 5 && lastData[4] == 5);
+}
+
+static void TestPageFull()
+{
+   FlashLog log(TEST_BLKNUM);
+   uint32_t snapshot[100] = { 0 }, delta[20] = { 0 };
+   int appended = 0;
+
+   Format();
+   log.Open(CountRecord);
+   log.StartPage(1, snapshot, 100);
+   uint32_t sequence = log.GetSequence();
+
+   while (log.Append(2, delta, 20)) appended++;
+
+   ASSERT(appended == 6);
+   ASSERT(Reopen(CountRecord) && numRecords == 7);
+
+   //The new page replaces everything before it
+   snapshot[0] = 42;
+   log.StartPage(1, snapshot, 100);
+   ASSERT(log.GetSequence() == sequence + 1);
+   ASSERT(Reopen(CountRecord) && numRecords == 1);
+   ASSERT(lastType == 1 && lastData[0] == 42);
+}
+
+static void TestTornRecord()
+{
+   FlashLog log(TEST_BLKNUM);
+   uint32_t snapshot[10] = { 0 }, delta[4] = { 7, 7, 7, 7 };
+
+   Format();
+   log.Open(CountRecord);
+   log.StartPage(1, snapshot, 10);
+   log.Append(2, delta, 4);
+   //Reset while writing the CRC of the second record
+   uint32_t address = FlashStore::GetBlockAddress(TEST_BLKNUM) + (2 + 12 + 5) * sizeof(uint32_t);
+   flash_program_word(address, 0);
+
+   ASSERT(log.Open(CountRecord));
+   ASSERT(log.GetFreeWords() == 0); //Never append behind a torn record
+   ASSERT(Reopen(CountRecord) && numRecords == 1 && lastType == 1);
+}
+
+static void TestLifetimeStatsReplay()
+{
+   FlashLog log(TEST_BLKNUM);
+   static uint32_t record[LS_SNAPSHOT_WORDS];
+   float voltages[LS_CELLS];
+   int words;
+
+   Format();
+   LifetimeStats::Reset();
+   log.Open(ReplayStats);
+
+   for (int i = 0; i < LS_CELLS; i++) voltages[i] = 3300;
+   LifetimeStats::AddCells(voltages, LS_CELLS, 100);
+   LifetimeStats::ClearDelta();
+   log.StartPage(LifetimeStats::REC_SNAPSHOT, LifetimeStats::GetStorage(), LifetimeStats::GetStorageWords());
+
+   //An hour of typical use touches a few bins per cell, that must fit behind the snapshot
+   for (int i = 0; i < LS_CELLS; i++) voltages[i] = 3700;
+   LifetimeStats::AddCells(voltages, LS_CELLS, 3000);
+   for (int i = 0; i < LS_CELLS; i++) voltages[i] = 3900;
+   LifetimeStats::AddCells(voltages, LS_CELLS, 600);
+   words = LifetimeStats::TakeDelta(record);
+   ASSERT(log.Append(LifetimeStats::REC_DELTA, record, words));
+
+   LifetimeStats::Reset();
+   ASSERT(log.Open(ReplayStats));
+   ASSERT(GetCellTime(0) == 3700);
+   ASSERT(GetCellTime(LS_CELLS - 1) == 3700);
+}
+
+REGISTER_TEST(FlashLogTest, TestSnapshotAndAppend, TestPageFull, TestTornRecord, TestLifetimeStatsReplay);
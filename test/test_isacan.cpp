@@ -0,0 +1,98 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "isacan.h"
+#include "stub_canhardware.h"
+
+class IsaCanTest: public UnitTest
+{
+   public:
+      IsaCanTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static float charge;
+static float lastDt;
+static int samples;
+
+static void CurrentHandler(float current, float dt)
+{
+   charge += current * dt;
+   lastDt = dt;
+   samples++;
+}
+
+//Builds an IVT-S result frame and passes it through the CAN stand-in
+static void SendResult(uint32_t canId, uint8_t counter, int32_t value, uint8_t status = 0)
+{
+   uint32_t v = value;
+   uint32_t data[2];
+
+   data[0] = (canId - ISA_ID_CURRENT) | ((counter & 0xF) | status) << 8;
+   data[0] |= ((v >> 24) & 0xFF) << 16 | ((v >> 16) & 0xFF) << 24;
+   data[1] = ((v >> 8) & 0xFF) | (v & 0xFF) << 8;
+   vcuCan->HandleRx(canId, data, 8);
+}
+
+static void TestDecode()
+{
+   CanStub can;
+   IsaCan isa(&can);
+
+   ASSERT(vcuCanId == 0x520);
+   SendResult(ISA_ID_CURRENT, 0, -123456);
+   SendResult(ISA_ID_U1, 0, 398765);
+   SendResult(ISA_ID_TEMP, 0, 251);
+   SendResult(ISA_ID_CHARGE, 0, -7200);
+   SendResult(ISA_ID_ENERGY, 0, 1500);
+
+   ASSERT(isa.GetCurrent() > -123.4561f && isa.GetCurrent() < -123.4559f);
+   ASSERT(isa.GetVoltage(0) > 398.76f && isa.GetVoltage(0) < 398.77f);
+   ASSERT(isa.GetTemperature() > 25.09f && isa.GetTemperature() < 25.11f);
+   ASSERT(isa.GetCharge() == -7200);
+   ASSERT(isa.GetEnergy() == 1500);
+}
+
+static void TestIntegration()
+{
+   CanStub can;
+   IsaCan isa(&can);
+
+   charge = 0;
+   samples = 0;
+   isa.SetCyclePeriod(10);
+   isa.SetCurrentHandler(CurrentHandler);
+
+   //One second of 100 A, every 5th frame is lost
+   for (int i = 0; i <= 100; i++)
+   {
+      if ((i % 5) != 4)
+         SendResult(ISA_ID_CURRENT, i, 100000);
+   }
+
+   ASSERT(samples == 80);
+   ASSERT(charge > 99.99f && charge < 100.01f);
+
+   SendResult(ISA_ID_CURRENT, 101, 100000, 0x20); //Error flag set
+   ASSERT(samples == 80 && isa.GetErrorFrames() == 1);
+   SendResult(ISA_ID_CURRENT, 102, 100000);
+   ASSERT(lastDt > 0.0199f && lastDt < 0.0201f);
+}
+
+//This line registers the test
+REGISTER_TEST(IsaCanTest, TestDecode, TestIntegration);
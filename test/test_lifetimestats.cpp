@@ -0,0 +1,85 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "lifetimestats.h"
+
+class LifetimeStatsTest: public UnitTest
+{
+   public:
+      LifetimeStatsTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestBins()
+{
+   const float voltages[] = { 2900, 3300, 4250 };
+
+   LifetimeStats::Reset();
+   LifetimeStats::AddCells(voltages, 3, 1);
+   LifetimeStats::AddCells(voltages, 3, 1);
+   LifetimeStats::AddTemperature(20, 30, 5);
+   LifetimeStats::AddCurrent(-150.5f);
+   LifetimeStats::AddCurrent(80);
+
+   ASSERT(LifetimeStats::GetVoltageTime(0, 0) == 2);
+   ASSERT(LifetimeStats::GetVoltageTime(1, 2) == 2); //3300 is the lower edge of bin 2
+   ASSERT(LifetimeStats::GetVoltageTime(2, LS_VOLTAGE_BINS - 1) == 2);
+   ASSERT(LifetimeStats::GetTemperatureTime(4) == 5);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_UMIN) == 2900);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_UMAX) == 4250);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_TEMPMIN) == 20);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_IDCMIN) == -150);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_IDCMAX) == 80);
+}
+
+static void TestDeltaReplay()
+{
+   const float voltages[] = { 3600, 3610 };
+   uint32_t snapshot[LS_SNAPSHOT_WORDS];
+   uint32_t record1[LS_DELTA_WORDS], record2[LS_DELTA_WORDS];
+
+   LifetimeStats::Reset();
+   LifetimeStats::AddCells(voltages, 2, 10);
+
+   for (int i = 0; i < LS_SNAPSHOT_WORDS; i++)
+      snapshot[i] = LifetimeStats::GetStorage()[i];
+   LifetimeStats::ClearDelta();
+
+   LifetimeStats::AddCells(voltages, 2, 3);
+   int words1 = LifetimeStats::TakeDelta(record1);
+   LifetimeStats::AddTemperature(-20, -15, 7);
+   int words2 = LifetimeStats::TakeDelta(record2);
+
+   ASSERT(words1 == LS_EXTREME_WORDS + 2);
+   ASSERT(words2 == LS_EXTREME_WORDS + 1);
+   ASSERT(LifetimeStats::TakeDelta(record2) == LS_EXTREME_WORDS);
+
+   //Simulate reboot
+   LifetimeStats::Reset();
+   ASSERT(LifetimeStats::Load(snapshot, LS_SNAPSHOT_WORDS));
+   ASSERT(LifetimeStats::ApplyDelta(record1, words1));
+   ASSERT(LifetimeStats::ApplyDelta(record2, words2));
+
+   ASSERT(LifetimeStats::GetVoltageTime(0, 3) == 13);
+   ASSERT(LifetimeStats::GetVoltageTime(1, 3) == 13);
+   ASSERT(LifetimeStats::GetTemperatureTime(0) == 7);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_TEMPMIN) == -20);
+   ASSERT(LifetimeStats::GetExtreme(LifetimeStats::EX_UMAX) == 3610);
+}
+
+REGISTER_TEST(LifetimeStatsTest, TestBins, TestDeltaReplay);
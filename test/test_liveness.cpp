@@ -0,0 +1,76 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "liveness.h"
+
+class LivenessTest: public UnitTest
+{
+   public:
+      LivenessTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestSequence()
+{
+   Liveness::Reset(3, 1000, 0);
+   Liveness::Receive(1, 0, 100);
+   Liveness::Receive(1, 1, 200);
+   Liveness::Receive(1, 3, 300); //one missed
+   Liveness::Receive(1, 3, 301); //duplicate
+   Liveness::Receive(1, 2, 400); //two missed
+   Liveness::Receive(1, 3, 1500); //late
+
+   ASSERT(Liveness::GetStat(1, Liveness::RECEIVED) == 6);
+   ASSERT(Liveness::GetStat(1, Liveness::MISSED) == 3);
+   ASSERT(Liveness::GetStat(1, Liveness::DUPLICATE) == 1);
+   ASSERT(Liveness::GetStat(1, Liveness::LATE) == 1);
+   ASSERT(Liveness::GetStat(1, Liveness::MAXGAP) == 1100);
+   ASSERT(Liveness::GetStat(2, Liveness::RECEIVED) == 0);
+}
+
+static void TestLostModule()
+{
+   Liveness::Reset(3, 1000, 0);
+
+   for (uint32_t t = 0; t <= 2000; t += 100)
+   {
+      Liveness::Receive(1, (t / 100) & 3, t);
+      Liveness::Receive(2, (t / 100) & 3, t);
+   }
+
+   ASSERT(Liveness::Run(2500, 3) == 0);
+
+   //Module 2 goes silent
+   for (uint32_t t = 2100; t <= 5000; t += 100)
+      Liveness::Receive(1, (t / 100) & 3, t);
+
+   ASSERT(Liveness::Run(5000, 3) == 0);
+   ASSERT(Liveness::Run(5100, 3) == 1);
+   ASSERT(Liveness::GetLostMask() == 4);
+   ASSERT(Liveness::Run(6000, 3) == 1);
+   ASSERT(Liveness::GetStat(2, Liveness::LOST) == 1);
+
+   //Coming back doesn't count the frames missed while lost
+   Liveness::Receive(2, 1, 6100);
+   ASSERT(Liveness::Run(6100, 3) == 0);
+   ASSERT(Liveness::GetStat(2, Liveness::MISSED) == 0);
+   ASSERT(Liveness::GetTotal(Liveness::MISSED) == 0);
+}
+
+//This line registers the test
+REGISTER_TEST(LivenessTest, TestSequence, TestLostModule);
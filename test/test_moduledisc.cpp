@@ -0,0 +1,166 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vector>
+#include "test.h"
+#include "moduledisc.h"
+
+#define BOOT_CYCLES 3 //Cycles from power up to listening on the bus
+
+class ModuleDiscoveryTest: public UnitTest
+{
+   public:
+      ModuleDiscoveryTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+struct SimNode
+{
+   ModuleDiscovery disc;
+   int poweredAt;
+   bool started;
+};
+
+//Runs an enable chain of numNodes modules on a shared bus, returns cycles until the master is done
+static int SimulateChain(int numNodes, std::vector<SimNode>& nodes)
+{
+   nodes.assign(numNodes, SimNode());
+   nodes[0].disc.StartAsMaster(10, 500, 12);
+   nodes[0].started = true;
+
+   for (int i = 1; i < numNodes; i++)
+   {
+      nodes[i].poweredAt = -1;
+      nodes[i].started = false;
+   }
+   nodes[1 % numNodes].poweredAt = numNodes > 1 ? 0 : -1; //Master enables the first sub module right away
+
+   for (int cycle = 0; cycle < 1000; cycle++)
+   {
+      for (int i = 0; i < numNodes; i++)
+      {
+         SimNode& node = nodes[i];
+
+         if (!node.started && node.poweredAt >= 0 && (cycle - node.poweredAt) >= BOOT_CYCLES)
+         {
+            node.disc.StartAsSub(16, DISC_NO_INDEX);
+            node.started = true;
+         }
+         if (!node.started) continue;
+
+         uint32_t canId, data[2];
+
+         if (node.disc.Run(canId, data))
+         {
+            for (int j = 0; j < numNodes; j++)
+               if (j != i && nodes[j].started) nodes[j].disc.HandleFrame(canId, data);
+         }
+
+         //Sub modules enable their successor once they have an address
+         if (i > 0 && i < (numNodes - 1) && node.disc.HasAddress() && nodes[i + 1].poweredAt < 0)
+            nodes[i + 1].poweredAt = cycle;
+      }
+
+      if (nodes[0].disc.GetState() == ModuleDiscovery::DONE)
+         return cycle + 1;
+   }
+   return -1;
+}
+
+static void TestSingleModule()
+{
+   std::vector<SimNode> nodes;
+   int cycles = SimulateChain(1, nodes);
+
+   ASSERT(cycles > 0 && nodes[0].disc.GetNumModules() == 1);
+}
+
+static void TestFullChain()
+{
+   std::vector<SimNode> nodes;
+   int cycles = SimulateChain(MAX_MODULES, nodes);
+
+   std::cout << MAX_MODULES << " modules enumerated in " << cycles * 100 << " ms" << std::endl;
+   ASSERT(nodes[0].disc.GetNumModules() == MAX_MODULES);
+   //The sequential enumeration took at least 1.6 s per module
+   ASSERT(cycles > 0 && cycles < MAX_MODULES * 7);
+
+   bool addressesOk = true;
+
+   for (int i = 1; i < MAX_MODULES; i++)
+   {
+      addressesOk &= nodes[i].disc.GetIndex() == i && nodes[i].disc.GetNodeId() == 10 + i;
+      addressesOk &= nodes[0].disc.GetCellsOfModule(i) == 16;
+   }
+   ASSERT(addressesOk);
+}
+
+static void TestRestartedModule()
+{
+   std::vector<SimNode> nodes;
+   SimulateChain(4, nodes);
+
+   //Module 2 browns out, the rest of the chain keeps running
+   nodes[2].disc.StartAsSub(16, 2);
+   int cycle;
+
+   for (cycle = 0; cycle < 100 && nodes[2].disc.GetState() == ModuleDiscovery::WAIT_TOKEN; cycle++)
+   {
+      uint8_t cells, lastIndex;
+
+      for (int i = 0; i < 4; i++)
+      {
+         uint32_t canId, data[2];
+
+         if (nodes[i].disc.Run(canId, data))
+         {
+            for (int j = 0; j < 4; j++)
+               if (j != i) nodes[j].disc.HandleFrame(canId, data);
+         }
+      }
+
+      //Module 2 has been reported lost by then
+      if (nodes[0].disc.GetHello(cells, lastIndex))
+         nodes[0].disc.Admit(ModuleDiscovery::ChooseRestartIndex(lastIndex, 1 << 2, 4, false));
+   }
+
+   std::cout << "Restarted module admitted after " << cycle * 100 << " ms" << std::endl;
+   ASSERT(cycle < 8);
+   ASSERT(nodes[2].disc.GetIndex() == 2 && nodes[2].disc.GetNodeId() == 12 && nodes[2].disc.GetPdoBase() == 500);
+   ASSERT(nodes[3].disc.GetIndex() == 3); //Untouched
+}
+
+static void TestRestartIndexPolicy()
+{
+   //Remembered index of a lost module is reused
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(2, 1 << 2, 4, false) == 2);
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(3, (1 << 1) | (1 << 3), 4, false) == 3);
+   //Stale index of a live module takes the first lost slot instead
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(2, 1 << 3, 4, false) == 3);
+   //Or waits until the module may be appended
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(2, 0, 4, false) == 0);
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(2, 0, 4, true) == 4);
+   //Out of range and unknown indexes
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(9, 1 << 1, 4, false) == 1);
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(DISC_NO_INDEX, 0, 4, true) == 4);
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(0, 0, 4, false) == 0);
+   //Chain is full
+   ASSERT(ModuleDiscovery::ChooseRestartIndex(DISC_NO_INDEX, 0, MAX_MODULES, true) == 0);
+}
+
+//This line registers the test
+REGISTER_TEST(ModuleDiscoveryTest, TestSingleModule, TestFullChain, TestRestartedModule, TestRestartIndexPolicy);
@@ -0,0 +1,132 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "packaggregator.h"
+#include "bmsio.h"
+
+class PackAggregatorTest: public UnitTest
+{
+   public:
+      PackAggregatorTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static ModuleData MakeData(uint16_t umin, uint16_t umax, uint16_t uavg, int8_t tempmin, int8_t tempmax)
+{
+   ModuleData d;
+   d.umin = umin;
+   d.umax = umax;
+   d.uavg = uavg;
+   d.tempmin = tempmin;
+   d.tempmax = tempmax;
+   d.numChan = 10;
+   return d;
+}
+
+static void TestIncrementalUpdate()
+{
+   PackAggregator::Reset(3, 0);
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 10);
+   PackAggregator::Update(1, MakeData(3400, 3700, 3560, 18, 25), 10);
+   PackAggregator::Update(2, MakeData(3450, 3650, 3540, NO_TEMP, NO_TEMP), 10);
+
+   ASSERT(PackAggregator::GetMin() == 3400);
+   ASSERT(PackAggregator::GetMax() == 3700);
+   ASSERT(PackAggregator::GetSum() == 106500);
+   ASSERT(PackAggregator::GetCells() == 30);
+   ASSERT(PackAggregator::GetTempMin() == 18);
+   ASSERT(PackAggregator::GetTempMax() == 25);
+
+   //Module 1 held both voltage extremes, they must move to the other modules
+   PackAggregator::Update(1, MakeData(3480, 3620, 3550, 19, 21), 20);
+   ASSERT(PackAggregator::GetMin() == 3450);
+   ASSERT(PackAggregator::GetMax() == 3650);
+   ASSERT(PackAggregator::GetSum() == 106400);
+   ASSERT(PackAggregator::GetTempMin() == 19);
+   ASSERT(PackAggregator::GetTempMax() == 22);
+}
+
+static void TestStaleModule()
+{
+   PackAggregator::Reset(3, 0);
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 100);
+   PackAggregator::Update(1, MakeData(3400, 3700, 3560, 18, 25), 100);
+   PackAggregator::Update(2, MakeData(3450, 3650, 3540, 20, 20), 100);
+
+   ASSERT(PackAggregator::CheckFreshness(1000, 1000) == 0);
+
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 1500);
+   PackAggregator::Update(2, MakeData(3450, 3650, 3540, 20, 20), 1500);
+
+   //Module 1 has gone silent
+   ASSERT(PackAggregator::CheckFreshness(2000, 1000) == 1);
+   ASSERT(!PackAggregator::IsFresh(1));
+   ASSERT(PackAggregator::GetStaleMask() == 2);
+   ASSERT(PackAggregator::GetMin() == 3450);
+   ASSERT(PackAggregator::GetMax() == 3650);
+   ASSERT(PackAggregator::GetCells() == 20);
+   ASSERT(PackAggregator::GetTempMin() == 20);
+
+   //And comes back
+   PackAggregator::Update(1, MakeData(3400, 3700, 3560, 18, 25), 2100);
+   ASSERT(PackAggregator::CheckFreshness(2200, 1000) == 0);
+   ASSERT(PackAggregator::GetMin() == 3400);
+   ASSERT(PackAggregator::GetCells() == 30);
+}
+
+static void TestModuleNeverSeen()
+{
+   PackAggregator::Reset(2, 5000);
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 5100);
+
+   ASSERT(PackAggregator::CheckFreshness(5900, 1000) == 0); //still in its grace period
+   ASSERT(PackAggregator::CheckFreshness(6100, 1000) == 1);
+   ASSERT(PackAggregator::GetMin() == 3500);
+}
+
+static void TestStaleCheckInterleaved()
+{
+   PackAggregator::Reset(2, 0);
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 100);
+   PackAggregator::Update(1, MakeData(3400, 3700, 3560, 18, 25), 100);
+
+   //Module 1 times out, repeated checks must not remove it again
+   PackAggregator::Update(0, MakeData(3500, 3600, 3550, 20, 22), 1150);
+   ASSERT(PackAggregator::CheckFreshness(1150, 1000) == 1);
+   ASSERT(PackAggregator::CheckFreshness(1160, 1000) == 1);
+   ASSERT(PackAggregator::GetSum() == 35500);
+   ASSERT(PackAggregator::GetCells() == 10);
+
+   //Its PDO arrives right after the check took its time stamp
+   PackAggregator::Update(1, MakeData(3400, 3700, 3560, 18, 25), 1170);
+   ASSERT(PackAggregator::CheckFreshness(1165, 1000) == 0);
+   ASSERT(PackAggregator::GetSum() == 71100);
+   ASSERT(PackAggregator::GetCells() == 20);
+   ASSERT(PackAggregator::GetMin() == 3400);
+
+   //Updates between checks only replace the contribution
+   PackAggregator::Update(1, MakeData(3410, 3690, 3570, 18, 25), 1200);
+   ASSERT(PackAggregator::CheckFreshness(1200, 1000) == 0);
+   PackAggregator::Update(1, MakeData(3410, 3690, 3570, 18, 25), 1250);
+   ASSERT(PackAggregator::GetSum() == 71200);
+   ASSERT(PackAggregator::GetCells() == 20);
+   ASSERT(PackAggregator::GetMin() == 3410);
+}
+
+//This line registers the test
+REGISTER_TEST(PackAggregatorTest, TestIncrementalUpdate, TestStaleModule, TestModuleNeverSeen, TestStaleCheckInterleaved);
@@ -0,0 +1,122 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "pdoscheduler.h"
+#include "stub_canhardware.h"
+
+class PdoSchedulerTest: public UnitTest
+{
+   public:
+      PdoSchedulerTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+//Counts frames per id, the CAN stand-in only keeps the last one
+class CountingCan: public CanHardware
+{
+   public:
+      CountingCan() { memset(sent, 0, sizeof(sent)); }
+      void SetBaudrate(enum baudrates) {}
+      void Send(uint32_t canId, uint32_t data[2], uint8_t)
+      {
+         sent[canId & 0xF]++;
+         frame = data[0] | ((uint64_t)data[1] << 32);
+      }
+      void ConfigureFilters() {}
+
+      int sent[16];
+      uint64_t frame;
+};
+
+//Normally implemented in main.cpp
+void Param::Change(Param::PARAM_NUM) {}
+
+static void TestDeadband()
+{
+   CountingCan can;
+
+   PdoScheduler::Clear();
+   int msg = PdoScheduler::AddMessage(0x101, PdoScheduler::PERIOD_10MS, 1000, 62);
+   ASSERT(PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 2));
+
+   Param::SetFloat(Param::umin0, 3300);
+   PdoScheduler::Run(&can); //First one always goes out
+   ASSERT(can.sent[1] == 1 && (can.frame & 0x3FFF) == 3300);
+
+   Param::SetFloat(Param::umin0, 3302);
+   PdoScheduler::Run(&can);
+   ASSERT(can.sent[1] == 1); //Within the deadband
+
+   Param::SetFloat(Param::umin0, 3303);
+   PdoScheduler::Run(&can);
+   ASSERT(can.sent[1] == 2 && (can.frame & 0x3FFF) == 3303);
+   ASSERT((can.frame >> 62) == 1); //Sequence counter of the second frame
+}
+
+static void TestMaxSilence()
+{
+   CountingCan can;
+
+   PdoScheduler::Clear();
+   int msg = PdoScheduler::AddMessage(0x101, PdoScheduler::PERIOD_10MS, 100, 62);
+   PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 2);
+
+   Param::SetFloat(Param::umin0, 3300);
+   PdoScheduler::Run(&can);
+
+   for (int i = 0; i < 9; i++)
+      PdoScheduler::Run(&can);
+
+   ASSERT(can.sent[1] == 1);
+   //100 ms without a change, send anyway
+   PdoScheduler::Run(&can);
+   ASSERT(can.sent[1] == 2);
+}
+
+static void TestRates()
+{
+   CountingCan can;
+
+   PdoScheduler::Clear();
+   int msg = PdoScheduler::AddMessage(0x101, PdoScheduler::PERIOD_10MS, 10000, 62);
+   PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 0);
+   msg = PdoScheduler::AddMessage(0x102, PdoScheduler::PERIOD_100MS, 10000, 62);
+   PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 0);
+   msg = PdoScheduler::AddMessage(0x103, PdoScheduler::PERIOD_1S, 10000, 62);
+   PdoScheduler::AddField(msg, Param::umin0, 0, 14, 1, 0);
+
+   //Let all of them send their first frame
+   for (int i = 0; i < 100; i++)
+      PdoScheduler::Run(&can);
+
+   memset(can.sent, 0, sizeof(can.sent));
+
+   //Changes every 10 ms, each message may only send at its own rate
+   for (int i = 0; i < 100; i++)
+   {
+      Param::SetFloat(Param::umin0, 3000 + i);
+      PdoScheduler::Run(&can);
+   }
+
+   ASSERT(can.sent[1] == 100);
+   ASSERT(can.sent[2] == 10);
+   ASSERT(can.sent[3] == 1);
+}
+
+//This line registers the test
+REGISTER_TEST(PdoSchedulerTest, TestDeadband, TestMaxSilence, TestRates);
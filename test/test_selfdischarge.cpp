@@ -0,0 +1,104 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "selfdischarge.h"
+#include "bmsalgo.h"
+
+#define CELLS 4
+
+class SelfDischargeTest: public UnitTest
+{
+   public:
+      SelfDischargeTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static uint32_t now = 100000;
+
+//Linear OCV curve, 100 mV per 10 %. With 100 Ah that is 360 As per mV
+static void SetLinearOcv()
+{
+   for (int i = 0; i <= 10; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, 3000 + i * 100);
+   SelfDischarge::SetNominalCapacity(100);
+}
+
+/** \brief Runs the estimator in 1 minute steps
+ * \param minutes duration
+ * \param rest pack at rest
+ * \param leakyCell this cell loses 1 mV/h, the others keep their voltage
+ * \return number of samples taken
+ */
+static int Simulate(int minutes, bool rest, int leakyCell)
+{
+   static float drift[CELLS];
+   int samples = 0;
+
+   for (int m = 0; m < minutes; m++)
+   {
+      float voltages[CELLS];
+
+      now += 60;
+      drift[leakyCell] -= 1 / 60.0f;
+
+      for (int i = 0; i < CELLS; i++)
+         voltages[i] = 3550 + drift[i];
+
+      if (SelfDischarge::Run(now, rest))
+      {
+         SelfDischarge::AddSample(now, voltages, CELLS);
+         samples++;
+      }
+   }
+   return samples;
+}
+
+static void TestKnownDrift()
+{
+   SetLinearOcv();
+
+   //The rest starts with the first step. Settling takes 30 minutes, then one sample every 10 minutes
+   ASSERT(Simulate(31 + 100, true, 2) == 11);
+   ASSERT(!SelfDischarge::IsValid());
+   ASSERT(Simulate(10, true, 2) == 1);
+   ASSERT(SelfDischarge::IsValid());
+
+   //1 mV/h below the others is 0.75 mV/h below the average: 270 As/h = 75 mA
+   ASSERT(SelfDischarge::GetWorstCell() == 2);
+   ASSERT(SelfDischarge::GetLeakageCurrent(2) > 74 && SelfDischarge::GetLeakageCurrent(2) < 76);
+   ASSERT(SelfDischarge::GetLeakageCurrent(0) > -26 && SelfDischarge::GetLeakageCurrent(0) < -24);
+}
+
+static void TestCurrentDiscardsWindow()
+{
+   SetLinearOcv();
+
+   //Current flows, then a rest with cell 0 leaking is cut short by current again
+   ASSERT(Simulate(10, false, 2) == 0);
+   ASSERT(Simulate(31 + 70, true, 0) == 8);
+   ASSERT(Simulate(10, false, 0) == 0);
+
+   //The next rest starts a new window, nothing of cell 0 may remain
+   ASSERT(Simulate(31 + 110, true, 2) == 12);
+   ASSERT(SelfDischarge::GetWorstCell() == 2);
+   ASSERT(SelfDischarge::GetLeakageCurrent(2) > 74 && SelfDischarge::GetLeakageCurrent(2) < 76);
+   ASSERT(SelfDischarge::GetLeakageCurrent(0) > -26 && SelfDischarge::GetLeakageCurrent(0) < -24);
+}
+
+//This line registers the test
+REGISTER_TEST(SelfDischargeTest, TestKnownDrift, TestCurrentDiscardsWindow);
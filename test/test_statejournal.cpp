@@ -0,0 +1,112 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "statejournal.h"
+#include "bmsalgo.h"
+
+class StateJournalTest: public UnitTest
+{
+   public:
+      StateJournalTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static StateJournal::State MakeState(float chargeIn, float chargeOut)
+{
+   StateJournal::State s = { chargeIn, chargeOut, 1.5f, 1.25f, 60, 80, -360 };
+   return s;
+}
+
+static void TestRecordRoundTrip()
+{
+   uint32_t record[JOURNAL_RECORD_WORDS];
+   StateJournal::State in = MakeState(7200, 3600), out;
+   uint16_t sequence = 0;
+
+   StateJournal::EncodeRecord(in, 42, record);
+
+   ASSERT(StateJournal::DecodeRecord(record, JOURNAL_RECORD_WORDS, out, sequence));
+   ASSERT(sequence == 42);
+   ASSERT(out.chargeIn == 7200 && out.chargeOut == 3600);
+   ASSERT(out.estimatedSocAtValidSoh == 80 && out.asDiffAfterEstimate == -360);
+   //Wrong size or version
+   ASSERT(!StateJournal::DecodeRecord(record, JOURNAL_RECORD_WORDS - 1, out, sequence));
+   record[0]++;
+   ASSERT(!StateJournal::DecodeRecord(record, JOURNAL_RECORD_WORDS, out, sequence));
+}
+
+static void TestBackupAddsDelta()
+{
+   uint16_t regs[JOURNAL_BACKUP_WORDS];
+   StateJournal::State saved = MakeState(7200, 3600);
+   StateJournal::State now = MakeState(7200 + 100000, 3600 + 25);
+   StateJournal::State restored = saved;
+
+   StateJournal::EncodeBackup(now, saved, 42, regs);
+
+   ASSERT(StateJournal::DecodeBackup(regs, 42, restored));
+   ASSERT(restored.chargeIn == now.chargeIn && restored.chargeOut == now.chargeOut);
+}
+
+static void TestBackupRejected()
+{
+   uint16_t regs[JOURNAL_BACKUP_WORDS] = { 0 };
+   StateJournal::State saved = MakeState(7200, 3600);
+   StateJournal::State restored = saved;
+
+   //Cleared registers after power loss without VBAT
+   ASSERT(!StateJournal::DecodeBackup(regs, 0, restored));
+
+   StateJournal::EncodeBackup(MakeState(8000, 3700), saved, 42, regs);
+   //Belongs to another flash record
+   ASSERT(!StateJournal::DecodeBackup(regs, 43, restored));
+   //Torn write
+   regs[3]++;
+   ASSERT(!StateJournal::DecodeBackup(regs, 42, restored));
+   ASSERT(restored.chargeIn == saved.chargeIn && restored.chargeOut == saved.chargeOut);
+}
+
+static void TestSocContinuousAfterReset()
+{
+   uint32_t record[JOURNAL_RECORD_WORDS];
+   uint16_t regs[JOURNAL_BACKUP_WORDS];
+   uint16_t sequence = 0;
+   //Record written on IDLE->RUN, the integration starts at 60 % and 3600 As
+   StateJournal::State saved = MakeState(7200, 3600), restored;
+   StateJournal::State now;
+
+   saved.asDiffAfterEstimate = saved.chargeIn - saved.chargeOut;
+   now = saved;
+   BmsAlgo::SetNominalCapacity(100);
+   StateJournal::EncodeRecord(saved, 1, record);
+
+   //Drive on and discharge 45 Ah, only the backup registers follow
+   now.chargeOut += 162000;
+   StateJournal::EncodeBackup(now, saved, 1, regs);
+   float socBefore = BmsAlgo::CalculateSocFromIntegration(now.estimatedSoc, now.chargeIn - now.chargeOut - now.asDiffAfterEstimate);
+
+   //Brown-out in RUN
+   ASSERT(StateJournal::DecodeRecord(record, JOURNAL_RECORD_WORDS, restored, sequence));
+   ASSERT(StateJournal::DecodeBackup(regs, sequence, restored));
+   float socAfter = BmsAlgo::CalculateSocFromIntegration(restored.estimatedSoc, restored.chargeIn - restored.chargeOut - restored.asDiffAfterEstimate);
+
+   ASSERT(socBefore == socAfter);
+   ASSERT(socAfter > 14.9f && socAfter < 15.1f);
+}
+
+REGISTER_TEST(StateJournalTest, TestRecordRoundTrip, TestBackupAddsDelta, TestBackupRejected, TestSocContinuousAfterReset);
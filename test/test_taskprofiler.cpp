@@ -0,0 +1,91 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <thread>
+#include "test.h"
+#include "taskprofiler.h"
+
+class TaskProfilerTest: public UnitTest
+{
+   public:
+      TaskProfilerTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static int calls = 0;
+
+static void SlowTask()
+{
+   calls++;
+   std::this_thread::sleep_for(std::chrono::microseconds(calls == 3 ? 2000 : 500));
+}
+
+static void TestWrappedTask()
+{
+   TaskProfiler::Reset();
+
+   for (int i = 0; i < 5; i++)
+      TaskProfiler::Run<SlowTask, 1>();
+
+   ASSERT(calls == 5);
+   ASSERT(TaskProfiler::GetStat(1, TaskProfiler::CALLS) == 5);
+   ASSERT(TaskProfiler::GetMicros(1, TaskProfiler::MIN) >= 500);
+   ASSERT(TaskProfiler::GetMicros(1, TaskProfiler::MAX) >= 2000);
+   ASSERT(TaskProfiler::GetStat(1, TaskProfiler::AVG) > TaskProfiler::GetStat(1, TaskProfiler::MIN));
+   ASSERT(TaskProfiler::GetStat(1, TaskProfiler::AVG) < TaskProfiler::GetStat(1, TaskProfiler::MAX));
+   ASSERT(TaskProfiler::GetStat(0, TaskProfiler::CALLS) == 0);
+}
+
+static void TestRecord()
+{
+   TaskProfiler::Reset();
+   TaskProfiler::Record(2, 720);
+   TaskProfiler::Record(2, 7200);
+   TaskProfiler::Record(TASKPROF_MAX_TASKS, 1); //Ignored
+
+   ASSERT(TaskProfiler::GetStat(2, TaskProfiler::MIN) == 720);
+   ASSERT(TaskProfiler::GetStat(2, TaskProfiler::AVG) == 3960);
+   ASSERT(TaskProfiler::GetMicros(2, TaskProfiler::MAX) == 100);
+}
+
+static void TestDeadline()
+{
+   const uint32_t ms = 1000 * TIMEBASE_CYCLES_PER_US;
+
+   TaskProfiler::Reset();
+   TaskProfiler::SetDeadline(3, 2, 300);
+
+   //Starts at 0, 2, 4.01, 6.5 and 8 ms, each run takes 0.1 ms except the last one
+   const uint32_t starts[] = { 0, 2 * ms, 4 * ms + ms / 100, 6 * ms + ms / 2, 8 * ms };
+
+   for (int i = 0; i < 5; i++)
+   {
+      TaskProfiler::CheckStart(3, starts[i]);
+      TaskProfiler::Record(3, i < 4 ? ms / 10 : 3 * ms);
+   }
+
+   ASSERT(TaskProfiler::GetJitterCount(3, 0) == 2); //2 ms and 2.01 ms intervals
+   ASSERT(TaskProfiler::GetJitterCount(3, 4) == 2); //2.49 ms and 1.5 ms, 490 and 500 us off
+   ASSERT(TaskProfiler::GetJitterCount(3, 5) == 0);
+   ASSERT(TaskProfiler::GetStat(3, TaskProfiler::LATE) == 2);
+   ASSERT(TaskProfiler::GetStat(3, TaskProfiler::OVERRUN) == 1);
+   ASSERT(TaskProfiler::CheckViolation(3));
+   ASSERT(!TaskProfiler::CheckViolation(3));
+}
+
+//This line registers the test
+REGISTER_TEST(TaskProfilerTest, TestWrappedTask, TestRecord, TestDeadline);
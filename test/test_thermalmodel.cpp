@@ -0,0 +1,76 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "thermalmodel.h"
+
+class ThermalModelTest: public UnitTest
+{
+   public:
+      ThermalModelTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+//1 mOhm, 1000 J/K, 0.5 K/W: 100 A heat 10 W, 5 K steady state, 500 s time constant
+static void SetupModel()
+{
+   ThermalModel::SetCellParameters(0.001f, 1000, 0.5f);
+   ThermalModel::SetCallingFrequency(10);
+}
+
+static float RunSeconds(ThermalModel& model, float current, float surfaceTemp, int seconds)
+{
+   float coreTemp = 0;
+
+   for (int i = 0; i < seconds * 10; i++)
+      coreTemp = model.Run(current, surfaceTemp);
+
+   return coreTemp;
+}
+
+static void TestStepResponse()
+{
+   ThermalModel model;
+
+   SetupModel();
+   ASSERT(model.Run(0, 25) == 25); //Starts in equilibrium with the surface
+
+   //After one time constant the core is 1 - 1/e of the way to steady state
+   float coreTemp = RunSeconds(model, 100, 25, 500);
+   ASSERT(coreTemp > 25 + 3.15f && coreTemp < 25 + 3.17f);
+}
+
+static void TestSteadyState()
+{
+   ThermalModel model;
+
+   SetupModel();
+   model.Run(0, 25);
+
+   //dT = I^2 * R * Rth
+   float coreTemp = RunSeconds(model, 100, 25, 5000);
+   ASSERT(coreTemp > 29.99f && coreTemp < 30.01f);
+   coreTemp = RunSeconds(model, -200, 25, 5000);
+   ASSERT(coreTemp > 44.99f && coreTemp < 45.01f);
+
+   //Follows the surface and cools down without current
+   coreTemp = RunSeconds(model, 0, 10, 5000);
+   ASSERT(coreTemp > 9.99f && coreTemp < 10.01f);
+}
+
+//This line registers the test
+REGISTER_TEST(ThermalModelTest, TestStepResponse, TestSteadyState);
@@ -0,0 +1,100 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "bmsalgo.h"
+#include "timepredictor.h"
+#include "my_math.h"
+
+class TimePredictorTest: public UnitTest
+{
+   public:
+      TimePredictorTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void TimePredictorTest::TestCaseSetup()
+{
+   uint16_t socLookup[] = { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
+
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, socLookup[i]);
+
+   BmsAlgo::SetChargeStage(0, 100, 4200, -40);
+   BmsAlgo::SetNumChargeStages(1);
+   TimePredictor::SetCapacity(100);
+   TimePredictor::SetCellResistance(1);
+   TimePredictor::SetCutoffCurrent(2);
+   TimePredictor::SetTarget(80);
+}
+
+static void RunToCompletion(float soc, float derating)
+{
+   for (int i = 0; i < 100; i++)
+      TimePredictor::Run(soc, 25, derating);
+}
+
+static void TestTimeToTarget()
+{
+   RunToCompletion(50, 1);
+   //Up to 80% the CV limit (4200 - 4000) / 1 mOhm = 200 A is above the CC current
+   //so 30 Ah at 100 A take 18 minutes
+   ASSERT(ABS(TimePredictor::GetTimeToTarget() - 18) < 0.01f);
+   ASSERT(TimePredictor::GetTimeToFull() > TimePredictor::GetTimeToTarget());
+}
+
+static void TestDeratingRestartsPrediction()
+{
+   RunToCompletion(50, 1);
+   RunToCompletion(50, 0.5f);
+   ASSERT(ABS(TimePredictor::GetTimeToTarget() - 36) < 0.01f);
+}
+
+static void TestUnreachable()
+{
+   //Already above target
+   RunToCompletion(90, 1);
+   ASSERT(TimePredictor::GetTimeToTarget() == 0);
+   ASSERT(TimePredictor::GetTimeToFull() > 0);
+
+   //The CV phase tapers below 60 A at about 94%
+   TimePredictor::SetCutoffCurrent(60);
+   TimePredictor::SetTarget(98);
+   RunToCompletion(50, 1);
+   ASSERT(TimePredictor::GetTimeToTarget() == TIME_UNREACHABLE);
+   ASSERT(TimePredictor::GetTimeToFull() > 0);
+
+   //Derated below the cutoff, no charge at all
+   RunToCompletion(50, 0.5f);
+   ASSERT(TimePredictor::GetTimeToTarget() == TIME_UNREACHABLE);
+   ASSERT(TimePredictor::GetTimeToFull() == TIME_UNREACHABLE);
+}
+
+static void TestTimeToEmpty()
+{
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, 3600);
+
+   //100 Ah at 3.6 V are 360 Wh, so 1 h at 360 W
+   ASSERT(ABS(TimePredictor::CalculateTimeToEmpty(100, -360, 1) - 60) < 0.01f);
+   ASSERT(ABS(TimePredictor::CalculateTimeToEmpty(50, -360, 1) - 30) < 0.01f);
+   ASSERT(TimePredictor::CalculateTimeToEmpty(50, 360, 1) == 0);
+}
+
+//This line registers the test
+REGISTER_TEST(TimePredictorTest, TestTimeToTarget, TestDeratingRestartsPrediction, TestUnreachable, TestTimeToEmpty);
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "trace.h"
+
+class TraceTest: public UnitTest
+{
+   public:
+      TraceTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestRecordLayout()
+{
+   uint32_t value = 0;
+
+   Trace::Clear();
+   Trace::Add(Trace::TR_LIMIT, 1, -5);
+
+   ASSERT(Trace::GetCount() == 1);
+   ASSERT(Trace::GetWord(0, 2, value) && value == (Trace::TR_LIMIT | (1 << 8) | (0xFFFBu << 16)));
+   ASSERT(!Trace::GetWord(1, 2, value));
+   ASSERT(!Trace::GetWord(0, TRACE_WORDS, value));
+}
+
+static void TestWrapAround()
+{
+   uint32_t value = 0;
+
+   Trace::Clear();
+
+   for (int i = 0; i < TRACE_SIZE + 10; i++)
+      Trace::Add(Trace::TR_BALANCE, i, 0);
+
+   //The oldest 10 records are overwritten
+   ASSERT(Trace::GetCount() == TRACE_SIZE + 10);
+   ASSERT(Trace::GetWord(0, 2, value) && ((value >> 8) & 0xFF) == 10);
+   ASSERT(Trace::GetWord(TRACE_SIZE - 1, 2, value) && ((value >> 8) & 0xFF) == TRACE_SIZE + 9);
+   ASSERT(!Trace::GetWord(TRACE_SIZE, 2, value));
+}
+
+static void TestFreeze()
+{
+   uint32_t value = 0;
+
+   Trace::Clear();
+   Trace::Add(Trace::TR_STATE, 8, 7);
+   Trace::Freeze(true);
+   Trace::Add(Trace::TR_STATE, 7, 8);
+   Trace::Freeze(false);
+
+   ASSERT(Trace::GetCount() == 1);
+   ASSERT(Trace::GetDropped() == 1);
+   ASSERT(Trace::GetWord(0, 2, value) && ((value >> 8) & 0xFF) == 8);
+}
+
+REGISTER_TEST(TraceTest, TestRecordLayout, TestWrapAround, TestFreeze);
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2026 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+"""Reads and decodes the event trace of a FlyingAdcBms module
+
+Read directly over CAN (needs python-can):
+   tracedecode.py --interface socketcan --channel can0 --node 1
+Or decode a dump with three hex words per line (cycles millis info):
+   tracedecode.py --dump trace.txt
+"""
+import argparse
+import struct
+import sys
+
+SDO_INDEX_TRACE = 0x4500
+SDO_INDEX_TRACECTRL = 0x4503
+TRACE_SIZE = 64
+CYCLES_PER_US = 72
+
+STATES = ["Boot", "GetAddr", "SetAddr", "ReqInfo", "RecvInfo", "Init", "SelfTest", "Run", "Idle", "Error", "Reboot"]
+BALANCE = ["Off", "Discharge", "ChargePos", "ChargeNeg"]
+RESULTS = ["Ongoing", "Success", "Failed", "Done"]
+LIMITS = ["chargelim", "dischargelim"]
+
+
+def name(table, idx):
+   return table[idx] if idx < len(table) else str(idx)
+
+
+def describe(kind, arg8, arg16):
+   if kind == 1:
+      return "STATE     %s -> %s" % (name(STATES, arg16), name(STATES, arg8))
+   if kind == 2:
+      return "BALANCE   cell %d %s" % (arg8, name(BALANCE, arg16))
+   if kind == 3:
+      return "SELFTEST  step %d %s errinfo %d" % (arg8 >> 2, name(RESULTS, arg8 & 3), arg16)
+   if kind == 4:
+      return "LIMIT     %s %d A" % (name(LIMITS, arg8), arg16)
+   if kind == 5:
+      return "I2C       bus busy, address 0x%02x, %d bytes skipped" % (arg8, arg16)
+   return "UNKNOWN   type %d %d %d" % (kind, arg8, arg16)
+
+
+def decode(records):
+   lastCycles = None
+
+   for cycles, millis, info in records:
+      kind = info & 0xFF
+      if kind == 0:
+         continue #record was being written
+      arg8 = (info >> 8) & 0xFF
+      arg16 = struct.unpack("<h", struct.pack("<H", info >> 16))[0]
+      #The cycle counter wraps after 59 s, only use it between close records
+      delta = ""
+      if lastCycles is not None:
+         delta = "+%d us" % (((cycles - lastCycles) & 0xFFFFFFFF) // CYCLES_PER_US)
+      lastCycles = cycles
+      print("%10.3f s %14s  %s" % (millis / 1000.0, delta, describe(kind, arg8, arg16)))
+
+
+def read_dump(path):
+   with open(path) as f:
+      return [tuple(int(w, 16) for w in line.split()[:3]) for line in f if line.strip()]
+
+
+def read_can(args):
+   import can
+
+   bus = can.Bus(interface=args.interface, channel=args.channel)
+
+   def sdo(cmd, index, sub, data=0):
+      bus.send(can.Message(arbitration_id=0x600 + args.node, is_extended_id=False,
+                           data=struct.pack("<BHBI", cmd, index, sub, data)))
+      while True:
+         msg = bus.recv(1.0)
+         if msg is None:
+            raise IOError("No SDO reply from node %d" % args.node)
+         if msg.arbitration_id == 0x580 + args.node:
+            cmd, rindex, rsub, value = struct.unpack("<BHBI", bytes(msg.data))
+            if rindex == index and rsub == sub:
+               if cmd == 0x80:
+                  raise IOError("SDO abort 0x%08x on 0x%04x/%d" % (value, index, sub))
+               return value
+
+   sdo(0x23, SDO_INDEX_TRACECTRL, 0, 1) #Freeze
+   try:
+      count = min(sdo(0x40, SDO_INDEX_TRACECTRL, 0), TRACE_SIZE)
+      records = [tuple(sdo(0x40, SDO_INDEX_TRACE + w, r) for w in range(3)) for r in range(count)]
+      dropped = sdo(0x40, SDO_INDEX_TRACECTRL, 1)
+   finally:
+      sdo(0x23, SDO_INDEX_TRACECTRL, 0, 0) #Resume
+      bus.shutdown()
+
+   if dropped:
+      print("%d records dropped while frozen" % dropped, file=sys.stderr)
+   return records
+
+
+def main():
+   parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+   parser.add_argument("--dump", help="text file with three hex words per record")
+   parser.add_argument("--interface", default="socketcan")
+   parser.add_argument("--channel", default="can0")
+   parser.add_argument("--node", type=int, default=1, help="SDO node id")
+   args = parser.parse_args()
+
+   decode(read_dump(args.dump) if args.dump else read_can(args))
+
+
+if __name__ == "__main__":
+   main()